@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#include "hal.hpp"
+#include "one_wire.hpp"
+#include "ds18b20.hpp"
+#include "ds18b20_bus.hpp"
+#include "ds18b20_registry.hpp"
+#include "rom_cache.hpp"
+
+// The devices of the bus, up to 64. They are static, as they do not fit on the stack.
+etl::vector<Ds18b20, 64> devices;
+etl::vector<Ds18b20, 64> cached_devices;
+etl::vector<std::optional<float>, 64> temperatures;
+Ds18b20Registry<64> registry;
+
+// The state at the start of a measured operation
+struct BenchmarkStart {
+    uint64_t time_us;
+    uint64_t sleep_time_us;
+};
+
+// Clears the statistics of the bus and returns the current state
+BenchmarkStart start_operation(OneWire& one_wire) {
+    one_wire.clear_statistics();
+    return { time_us_64(), Hal::get_sleep_time_us() };
+}
+
+void print_header() {
+    printf("operation,resolution,devices,time_us,cpu_busy_us,bus_time_us,resets,write_slots,read_slots,masked_slots,max_interrupts_disabled_us\n");
+}
+
+// Prints one CSV line with the cost of an operation, since the start_operation() call. The CPU is busy whenever
+// the library does not sleep.
+void print_result(const char* operation, int resolution, const OneWire& one_wire, const BenchmarkStart& start) {
+    uint64_t time_us = time_us_64() - start.time_us;
+    uint64_t cpu_busy_us = time_us - (Hal::get_sleep_time_us() - start.sleep_time_us);
+    OneWireStatistics statistics = one_wire.get_statistics();
+    printf("%s,%d,%d,%llu,%llu,%llu,%lu,%lu,%lu,%lu,%lu\n", operation, resolution, (int)devices.size(),
+        (unsigned long long)time_us, (unsigned long long)cpu_busy_us, (unsigned long long)statistics.bus_time_us,
+        (unsigned long)statistics.resets, (unsigned long)statistics.write_slots, (unsigned long)statistics.read_slots,
+        (unsigned long)statistics.masked_slots, (unsigned long)statistics.max_interrupts_disabled_us);
+}
+
+// Runs each operation on all devices of the bus (at each resolution) and prints its cost
+void run_benchmark(OneWire& one_wire) {
+    // Find all the devices of the bus
+    BenchmarkStart start = start_operation(one_wire);
+    Ds18b20::find_devices(one_wire, devices);
+    if (devices.size() == 0) {
+        printf("Did not find any devices\n");
+        return;
+    }
+    print_result("find_devices", 0, one_wire, start);
+
+    start = start_operation(one_wire);
+    registry.find_devices(one_wire);
+    print_result("registry_find_devices", 0, one_wire, start);
+
+    // Restore the same devices from the Rom cache. It is only saved (which erases the flash sector) if it does not
+    // hold these devices yet.
+    if (!RomCache::load(one_wire, cached_devices) || cached_devices.size() != devices.size()) {
+        RomCache::save(devices);
+    }
+    start = start_operation(one_wire);
+    RomCache::load(one_wire, cached_devices);
+    print_result("load_cached_devices", 0, one_wire, start);
+
+    Ds18b20Bus bus(one_wire);
+    Resolution resolutions[4] = { Resolution::Low, Resolution::Medium, Resolution::High, Resolution::VeryHigh };
+    for (int r = 0; r < 4; r++) {
+        int resolution = 9 + r;
+
+        // Set the resolution of all devices
+        start = start_operation(one_wire);
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i].set_resolution(resolutions[r], false);
+        }
+        print_result("set_resolution", resolution, one_wire, start);
+
+        // Measure all devices one by one
+        start = start_operation(one_wire);
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i].measure_temperature();
+        }
+        print_result("measure_temperature", resolution, one_wire, start);
+
+        // Measure all devices with a single conversion
+        start = start_operation(one_wire);
+        bus.measure_temperatures(devices, temperatures);
+        print_result("measure_temperatures", resolution, one_wire, start);
+
+        // Measure all devices with a single conversion, reading only the temperature bytes
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i].set_fast_read(true);
+        }
+        start = start_operation(one_wire);
+        bus.measure_temperatures(devices, temperatures);
+        print_result("measure_temperatures_fast", resolution, one_wire, start);
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i].set_fast_read(false);
+        }
+
+        // Measure all devices of the registry with a single conversion
+        registry.read_temperatures(one_wire);
+        start = start_operation(one_wire);
+        registry.measure_temperatures(one_wire);
+        print_result("registry_measure_temperatures", resolution, one_wire, start);
+
+        // Ping all devices
+        start = start_operation(one_wire);
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i].ping();
+        }
+        print_result("ping", resolution, one_wire, start);
+    }
+
+    // Measure all devices with each predefined timing profile of the bit-banged slots (at the last resolution)
+    const char* profile_operations[3] = { "measure_temperatures_standard", "measure_temperatures_long_line", "measure_temperatures_short_line" };
+    OneWireTimingProfile profiles[3] = { OneWireTimingProfile::Standard, OneWireTimingProfile::LongLine, OneWireTimingProfile::ShortLine };
+    for (int p = 0; p < 3; p++) {
+        one_wire.set_timing_profile(profiles[p]);
+        start = start_operation(one_wire);
+        bus.measure_temperatures(devices, temperatures);
+        print_result(profile_operations[p], 12, one_wire, start);
+    }
+    one_wire.set_timing_profile(OneWireTimingProfile::Standard);
+
+    // Measure all devices with the interrupts disabled during each slot
+    one_wire.set_interrupt_masking(OneWireInterruptMasking::Slot);
+    start = start_operation(one_wire);
+    bus.measure_temperatures(devices, temperatures);
+    print_result("measure_temperatures_masked", 12, one_wire, start);
+    one_wire.set_interrupt_masking(OneWireInterruptMasking::None);
+}
+
+int main()
+{
+    // Enable stdio and wait for serial monitor to connect
+    stdio_init_all();
+    while (!stdio_usb_connected()) {
+        tight_loop_contents();
+    }
+    sleep_ms(1000);
+    printf("Starting...\n");
+
+    // Benchmark the devices on the data pin (0)
+    OneWire one_wire(0);
+    print_header();
+    run_benchmark(one_wire);
+
+    fflush(stdout);
+    sleep_ms(1000);
+    return 0;
+}
@@ -30,14 +30,16 @@ int main()
         }
     }
 
-    // Set the temperature alarm limits of the devices
+    // Set the temperature alarm limits of the devices, with a single scratchpad write and EEPROM write per device
+    // (nothing is written if a device already has these limits)
     for (int i = 0; i < devices.size(); i++) {
-        bool success0 = devices[i].set_temperature_low_limit(-20, true);
-        bool success1 = devices[i].set_temperature_high_limit(80, true);
-        if (!success0 || !success1) {
+        Ds18b20Configuration configuration = devices[i].get_configuration();
+        configuration.set_temperature_low_limit(-20).set_temperature_high_limit(80);
+        if (!devices[i].configure(configuration, true)) {
             printf("Could not set temperature limits for a device\n");
             return 1;
         }
+        printf("EEPROM writes avoided: %lu\n", (unsigned long)devices[i].get_configuration_statistics().eeprom_writes_avoided);
     }
 
     for (int i = 0; i < devices.size(); i++) {
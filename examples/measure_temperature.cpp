@@ -23,15 +23,15 @@ int main()
     }
 
     // Check if the devices are successfully initialized
-    for (int i = 0; i < devices.size(); i++) {
+    for (size_t i = 0; i < devices.size(); i++) {
         if (!devices[i].is_successfully_initialized()) {
-            printf("Could not initialize device index %d\n", i);
+            printf("Could not initialize device index %d\n", (int)i);
             return 0;
         }
     }
 
     // Set the resolution of the devices
-    for (int i = 0; i < devices.size(); i++) {
+    for (size_t i = 0; i < devices.size(); i++) {
         bool success = devices[i].set_resolution(Resolution::VeryHigh, true);
         if (!success) {
             printf("Could not set accuracy for a device\n");
@@ -42,7 +42,7 @@ int main()
     // Continuously calculate and print the temperatures
     while (true) {
         printf("| ");
-        for (int i = 0; i < devices.size(); i++) {
+        for (size_t i = 0; i < devices.size(); i++) {
             std::optional<float> result = devices[i].measure_temperature();
             if (result.has_value()) {
                 float temperature = result.value();
@@ -0,0 +1,68 @@
+#include "acquisition_service.hpp"
+
+#include "hal.hpp"
+
+AcquisitionService* AcquisitionService::s_core1_service = nullptr;
+
+bool AcquisitionService::add_bus(OneWire& one_wire, Ds18b20RegistryBase& registry) {
+    return m_bus_manager.add_bus(one_wire, registry);
+}
+
+void AcquisitionService::acquire() {
+    m_bus_manager.measure_temperatures();
+    uint64_t timestamp = Hal::get_time_us();
+
+    // Publish one sample per device
+    for (size_t b = 0; b < m_bus_manager.get_bus_count(); b++) {
+        const Ds18b20RegistryBase& registry = m_bus_manager.get_registry(b);
+        bool ok = m_bus_manager.is_measured(b);
+        uint64_t conversion_start = m_bus_manager.get_conversion_start_us(b);
+        uint64_t conversion_end = m_bus_manager.get_conversion_end_us(b);
+        for (size_t i = 0; i < registry.size(); i++) {
+            std::optional<int16_t> temperature = registry.get_raw_temperature(i);
+
+            Sample sample;
+            sample.rom = Rom::encode_rom(registry.get_rom(i));
+            sample.timestamp_us = timestamp;
+            sample.conversion_start_us = conversion_start;
+            sample.conversion_end_us = conversion_end;
+            sample.read_latency_us = ok ? timestamp - conversion_end : 0;
+            sample.valid = ok && temperature.has_value();
+            sample.temperature = temperature.value_or(0);
+            m_samples.push(sample);
+        }
+    }
+}
+
+void AcquisitionService::core1_entry() {
+    AcquisitionService* service = s_core1_service;
+    while (service->m_running.load()) {
+        uint32_t start_time = Hal::get_time_ms();
+        service->acquire();
+
+        // Wait for the next period
+        uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+        if (elapsed_time < service->m_period_ms) {
+            Hal::sleep_ms(service->m_period_ms - elapsed_time);
+        }
+    }
+}
+
+void AcquisitionService::start(uint32_t period_ms) {
+    m_period_ms = period_ms;
+    m_running.store(true);
+    s_core1_service = this;
+    Hal::launch_core1(core1_entry);
+}
+
+void AcquisitionService::stop() {
+    m_running.store(false);
+}
+
+bool AcquisitionService::pop_sample(Sample& sample) {
+    return m_samples.pop(sample);
+}
+
+uint32_t AcquisitionService::get_overflow_count() const {
+    return m_samples.get_overflow_count();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+
+#include "bus_manager.hpp"
+#include "sample.hpp"
+#include "spsc_ring.hpp"
+
+/**
+ * Runs the temperature acquisition of one or more OneWire buses on core 1, so that the bus traffic does not
+ * block the application on core 0. Every period, all devices of every bus are measured (with the conversions
+ * of all buses running concurrently, see BusManager) and their samples are published to core 0 through a lock-free ring buffer.
+ */
+class AcquisitionService {
+public:
+    static const size_t m_ring_capacity = 64; ///< The maximum number of samples waiting to be popped
+
+private:
+    BusManager m_bus_manager; ///< The buses to acquire samples from
+
+    SpscRing<Sample, m_ring_capacity> m_samples; ///< The samples published to the consumer
+
+    uint32_t m_period_ms = 1000; ///< The time between the start of two acquisitions
+
+    std::atomic<bool> m_running{false}; ///< Whether the acquisition loop on core 1 should keep running
+
+    static AcquisitionService* s_core1_service; ///< The service running on core 1
+
+    /**
+     * The entry point of core 1. Acquires samples every period until stop() is called.
+     */
+    static void core1_entry();
+
+public:
+    /**
+     * Adds a bus to acquire samples from. Must be called before start().
+     * @param one_wire The OneWire object of the bus.
+     * @param registry The devices of the bus (find_devices must already have been called).
+     * @return True if the bus was added, false if the maximum number of buses was reached.
+     */
+    bool add_bus(OneWire& one_wire, Ds18b20RegistryBase& registry);
+
+    /**
+     * Measures all devices of all buses once and publishes their samples. Called periodically by core 1 after
+     * start(), but it can also be called directly (on any core) if the service is not started.
+     */
+    void acquire();
+
+    /**
+     * Launches the acquisition loop on core 1. Only one service can run on core 1 at a time.
+     * @param period_ms The time between the start of two acquisitions.
+     */
+    void start(uint32_t period_ms);
+
+    /**
+     * Requests the acquisition loop on core 1 to stop after the current acquisition.
+     */
+    void stop();
+
+    /**
+     * Removes the oldest published sample. Must only be called by a single consumer (core 0).
+     * @param sample Set to the oldest sample.
+     * @return True if a sample was available, false if not.
+     */
+    bool pop_sample(Sample& sample);
+
+    /**
+     * @return The number of samples dropped because the consumer did not pop them in time.
+     */
+    uint32_t get_overflow_count() const;
+};
@@ -0,0 +1,173 @@
+#include "bus_manager.hpp"
+
+#include "ds18b20_bus.hpp"
+
+#include "hal.hpp"
+
+BusManager::BusManager(const RetryPolicies& retry_policies) : m_retry_policies(retry_policies) {
+
+}
+
+void BusManager::set_conversion_timeout_ms(uint32_t timeout_ms) {
+    m_conversion_timeout_ms = timeout_ms;
+}
+
+bool BusManager::add_bus(OneWire& one_wire, Ds18b20RegistryBase& registry) {
+    if (m_buses.full()) {
+        return false;
+    }
+
+    m_buses.push_back({ &one_wire, &registry, PowerSupplyMode::External, DeviceCommands::m_max_conversion_time_ms, 0, 0, false, false,
+        0, false, {} });
+    return true;
+}
+
+size_t BusManager::measure_temperatures() {
+    // Start the conversion on every bus without waiting for it
+    for (size_t b = 0; b < m_buses.size(); b++) {
+        Bus& bus = m_buses[b];
+        bus.converting = false;
+        bus.measured = false;
+        // The power supply mode is only read by the first conversion after the devices were found
+        Ds18b20Bus ds18b20_bus(*bus.one_wire, m_retry_policies);
+        ds18b20_bus.set_power_supply_mode(bus.registry->m_power_supply_mode);
+        std::optional<PowerSupplyMode> power_supply_mode = ds18b20_bus.get_power_supply_mode();
+        if (!power_supply_mode.has_value()) {
+            continue;
+        }
+        bus.registry->m_power_supply_mode = power_supply_mode;
+        bus.power_supply_mode = power_supply_mode.value();
+        bus.conversion_time_ms = DeviceCommands::get_conversion_time_ms(bus.registry->get_max_resolution());
+        Retry retry(m_retry_policies.get(RetryOperation::Measure));
+        while (retry.next()) {
+            if (!bus.one_wire->reset()) {
+                continue;
+            }
+            DeviceCommands::skip_rom(*bus.one_wire);
+            DeviceCommands::start_convert_t(*bus.one_wire, bus.power_supply_mode);
+
+            bus.conversion_start_us = Hal::get_time_us();
+            bus.converting = true;
+            break;
+        }
+    }
+
+    // Poll the buses in turn until all conversions have completed. A bus is left idle until the conversion
+    // time of the highest resolution on it has passed. The wait is bounded by the deadline of the Measure policy.
+    uint32_t timeout = m_conversion_timeout_ms;
+    uint32_t deadline_ms = m_retry_policies.get(RetryOperation::Measure).deadline_us / 1000;
+    if (deadline_ms > 0 && deadline_ms < timeout) {
+        timeout = deadline_ms;
+    }
+    uint32_t start_time = Hal::get_time_ms();
+    size_t converting_count = 0;
+    bool timed_out = false;
+    do {
+        converting_count = 0;
+        uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+        timed_out = elapsed_time >= timeout;
+        for (size_t b = 0; b < m_buses.size(); b++) {
+            Bus& bus = m_buses[b];
+            if (!bus.converting) {
+                continue;
+            }
+
+            // Devices in parasite power mode cannot signal the completion, wait for the conversion time. Otherwise,
+            // the completion is checked at least once, even if the timeout is shorter than the conversion time.
+            bool complete = elapsed_time >= bus.conversion_time_ms;
+            if (bus.power_supply_mode == PowerSupplyMode::Parasite) {
+                if (complete) {
+                    bus.one_wire->set_strong_pullup(false);
+                }
+            } else if (complete || timed_out) {
+                complete = DeviceCommands::is_conversion_complete(*bus.one_wire);
+            }
+
+            if (complete) {
+                bus.conversion_end_us = Hal::get_time_us();
+                bus.converting = false;
+                bus.measured = true;
+            } else {
+                converting_count++;
+            }
+        }
+        if (converting_count > 0 && !timed_out) {
+            Hal::sleep_ms(1);
+        }
+    } while (converting_count > 0 && !timed_out);
+
+    // Read the results
+    size_t measured_count = 0;
+    for (size_t b = 0; b < m_buses.size(); b++) {
+        Bus& bus = m_buses[b];
+        if (bus.converting && bus.power_supply_mode == PowerSupplyMode::Parasite) {
+            bus.one_wire->set_strong_pullup(false);
+        }
+        bus.converting = false;
+        bus.read_index = bus.measured ? 0 : bus.registry->size();
+        bus.reading = false;
+        if (bus.measured) {
+            measured_count++;
+        }
+    }
+    read_temperatures();
+
+    return measured_count;
+}
+
+void BusManager::read_temperatures() {
+    // Visit the buses in turn: collect the finished read of a bus and start its next one. A read that failed is
+    // retried right away with the Read policy (see Ds18b20RegistryBase::read_scratchpad), without interleaving.
+    size_t reading_count = 0;
+    do {
+        reading_count = 0;
+        for (size_t b = 0; b < m_buses.size(); b++) {
+            Bus& bus = m_buses[b];
+            Ds18b20RegistryBase& registry = *bus.registry;
+            if (bus.reading) {
+                if (!bus.one_wire->is_transaction_complete()) {
+                    reading_count++;
+                    continue;
+                }
+                bus.reading = false;
+                CommandResult<Scratchpad> scratchpad = DeviceCommands::finish_read_scratchpad(*bus.one_wire, bus.scratchpad_data);
+                if (scratchpad.has_value()) {
+                    registry.store_scratchpad(bus.read_index, scratchpad.value());
+                } else {
+                    registry.read_scratchpad(*bus.one_wire, bus.read_index);
+                }
+                bus.read_index++;
+            }
+
+            if (bus.read_index < registry.size()) {
+                if (DeviceCommands::start_read_scratchpad(*bus.one_wire, registry.get_rom(bus.read_index), bus.scratchpad_data)) {
+                    bus.reading = true;
+                } else {
+                    registry.read_scratchpad(*bus.one_wire, bus.read_index);
+                    bus.read_index++;
+                }
+                reading_count++;
+            }
+        }
+    } while (reading_count > 0);
+}
+
+size_t BusManager::get_bus_count() const {
+    return m_buses.size();
+}
+
+const Ds18b20RegistryBase& BusManager::get_registry(size_t index) const {
+    return *m_buses[index].registry;
+}
+
+bool BusManager::is_measured(size_t index) const {
+    return m_buses[index].measured;
+}
+
+uint64_t BusManager::get_conversion_start_us(size_t index) const {
+    return m_buses[index].conversion_start_us;
+}
+
+uint64_t BusManager::get_conversion_end_us(size_t index) const {
+    return m_buses[index].conversion_end_us;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ds18b20_registry.hpp"
+#include "retry_policy.hpp"
+
+#include "etl/vector.h"
+
+/**
+ * Coordinates several OneWire buses (one per GPIO pin). The conversions of all buses are started back to back
+ * without waiting, so they run concurrently and a measurement of all buses costs a single conversion time
+ * instead of one per bus. The completion of the buses is then polled in turn, and the scratchpad reads of the buses
+ * are interleaved: while the slot engine of a bus (Pio backend) transfers the read of one device, the CPU starts and
+ * checks the reads of the other buses, so the reads of all buses overlap too.
+ */
+class BusManager {
+public:
+    static const size_t m_max_buses = 4; ///< The maximum number of buses
+
+private:
+    /// A bus, the devices found on it and the state of its last measurement
+    struct Bus {
+        OneWire* one_wire;
+        Ds18b20RegistryBase* registry;
+        PowerSupplyMode power_supply_mode;
+        uint32_t conversion_time_ms;
+        uint64_t conversion_start_us;
+        uint64_t conversion_end_us;
+        bool converting;
+        bool measured;
+        size_t read_index; ///< The index of the device whose scratchpad is read next (or being read)
+        bool reading; ///< Whether the scratchpad of the read_index-th device is being read (see DeviceCommands::start_read_scratchpad)
+        uint8_t scratchpad_data[9]; ///< The bytes of the scratchpad being read
+    };
+
+    /**
+     * Reads the scratchpad of every device of the measured buses into their registries, interleaving the buses.
+     */
+    void read_temperatures();
+
+    etl::vector<Bus, m_max_buses> m_buses; ///< The managed buses
+
+    const RetryPolicies& m_retry_policies; ///< How the start of the conversions is retried when it fails.
+
+    uint32_t m_conversion_timeout_ms = DeviceCommands::m_conversion_timeout_ms; ///< The maximum time a temperature measurement can take.
+
+public:
+    /**
+     * Creates a BusManager without buses.
+     * @param retry_policies How the start of the conversions is retried when it fails (the Measure and PowerSupply
+     * policies are used). The deadline of the Measure policy also bounds the wait for the conversions.
+     * Must outlive the object.
+     */
+    explicit BusManager(const RetryPolicies& retry_policies = RetryPolicies::get_default());
+
+    /**
+     * Sets the time after which the conversion of a bus is considered failed.
+     * @param timeout_ms The timeout in milliseconds (1000 by default).
+     */
+    void set_conversion_timeout_ms(uint32_t timeout_ms);
+
+    /**
+     * Adds a bus to the manager.
+     * @param one_wire The OneWire object of the bus.
+     * @param registry The devices of the bus (find_devices must already have been called).
+     * @return True if the bus was added, false if the maximum number of buses was reached.
+     */
+    bool add_bus(OneWire& one_wire, Ds18b20RegistryBase& registry);
+
+    /**
+     * Conducts a temperature measurement on all devices of all buses, with the conversions of all buses running
+     * concurrently, and then reads the temperature of each device into its registry.
+     * @return The number of buses that were measured successfully.
+     */
+    size_t measure_temperatures();
+
+    /**
+     * @return The number of managed buses.
+     */
+    size_t get_bus_count() const;
+
+    /**
+     * @return The devices of the index-th bus.
+     */
+    const Ds18b20RegistryBase& get_registry(size_t index) const;
+
+    /**
+     * @return True if the last measurement of the index-th bus was successful, false if not.
+     */
+    bool is_measured(size_t index) const;
+
+    /**
+     * @return The time (us since boot) at which the last conversion of the index-th bus was requested.
+     */
+    uint64_t get_conversion_start_us(size_t index) const;
+
+    /**
+     * @return The time (us since boot) at which the last conversion of the index-th bus was found complete.
+     */
+    uint64_t get_conversion_end_us(size_t index) const;
+};
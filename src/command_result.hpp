@@ -0,0 +1,70 @@
+#pragma once
+
+#include <optional>
+
+/// The reason a command failed
+enum class CommandError {
+    None, ///< The command was successful
+    NoPresence, ///< No device answered the reset pulse
+    NoResponse, ///< The selected device(s) did not answer (every bit was read as 1)
+    CrcMismatch, ///< The data was received with an invalid CRC code
+    Timeout, ///< The device did not complete the operation in time
+    InvalidData ///< The data could not have been sent by a working device (e.g. out of range)
+};
+
+/**
+ * The result of a command: either a value, or the reason the command failed. Has the same accessors as
+ * std::optional, so it can be used in its place.
+ */
+template <typename T>
+class CommandResult {
+private:
+    std::optional<T> m_value; ///< The value returned by the command, if it was successful
+    CommandError m_error; ///< The reason the command failed, or CommandError::None
+
+public:
+    /**
+     * Creates a successful result.
+     */
+    CommandResult(const T& value) : m_value(value), m_error(CommandError::None) {}
+
+    /**
+     * Creates a failed result.
+     */
+    CommandResult(CommandError error) : m_value(std::nullopt), m_error(error) {}
+
+    /**
+     * @return True if the command was successful, false if not.
+     */
+    bool has_value() const {
+        return m_value.has_value();
+    }
+
+    /**
+     * @return The value returned by the command. Must only be called if the command was successful.
+     */
+    const T& value() const {
+        return m_value.value();
+    }
+
+    /**
+     * @return A pointer to the value returned by the command. Must only be called if the command was successful.
+     */
+    const T* operator->() const {
+        return &m_value.value();
+    }
+
+    /**
+     * @return The value returned by the command, or default_value if it failed.
+     */
+    T value_or(const T& default_value) const {
+        return m_value.value_or(default_value);
+    }
+
+    /**
+     * @return The reason the command failed, or CommandError::None if it was successful.
+     */
+    CommandError get_error() const {
+        return m_error;
+    }
+};
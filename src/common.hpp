@@ -3,7 +3,9 @@ enum class RomCommands {
     MatchRom = 0x55,
     SkipRom = 0xCC,
     SearchRom = 0xF0,
-    SearchAlarm = 0xEC
+    SearchAlarm = 0xEC,
+    OverdriveSkipRom = 0x3C,
+    OverdriveMatchRom = 0x69
 };
 
 enum class FunctionCommands {
@@ -11,5 +13,6 @@ enum class FunctionCommands {
     ReadScratchpad = 0xBE,
     WriteScratchpad = 0x4E,
     CopyScratchpad = 0x48,
+    RecallEeprom = 0xB8,
     ReadPowerSupply = 0xB4
 };
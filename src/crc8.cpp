@@ -0,0 +1,88 @@
+#include "crc8.hpp"
+
+namespace {
+    constexpr uint8_t calculate_bitwise(uint8_t crc, uint8_t byte) {
+        crc ^= byte;
+        for (int i = 0; i < 8; i++) {
+            if (crc & 0x01) {
+                crc = (crc >> 1) ^ 0x8C;
+            } else {
+                crc >>= 1;
+            }
+        }
+
+        return crc;
+    }
+
+    struct Table {
+        uint8_t values[256];
+    };
+
+    struct NibbleTables {
+        uint8_t low[16]; ///< CRC of the low nibble of a byte
+        uint8_t high[16]; ///< CRC of the high nibble of a byte
+    };
+
+    constexpr Table generate_table() {
+        Table table = {};
+        for (int i = 0; i < 256; i++) {
+            table.values[i] = calculate_bitwise(0, i);
+        }
+
+        return table;
+    }
+
+    constexpr NibbleTables generate_nibble_tables() {
+        NibbleTables tables = {};
+        for (int i = 0; i < 16; i++) {
+            tables.low[i] = calculate_bitwise(0, i);
+            tables.high[i] = calculate_bitwise(0, i << 4);
+        }
+
+        return tables;
+    }
+
+    constexpr NibbleTables nibble_tables = generate_nibble_tables();
+
+    constexpr Table table = generate_table();
+
+    static_assert(calculate_bitwise(0, 0x01) == 0x5E, "Wrong CRC8 polynomial");
+    static_assert(sizeof(Table) == Crc8::m_table_size && sizeof(NibbleTables) == Crc8::m_nibble_tables_size,
+        "Wrong table sizes");
+}
+
+uint8_t Crc8::update(uint8_t crc, uint8_t byte) {
+#ifdef DS18B20_CRC8_NIBBLE_TABLE
+    return update_nibble_tables(crc, byte);
+#else
+    return update_table(crc, byte);
+#endif
+}
+
+uint8_t Crc8::update_table(uint8_t crc, uint8_t byte) {
+    return table.values[crc ^ byte];
+}
+
+uint8_t Crc8::update_nibble_tables(uint8_t crc, uint8_t byte) {
+    // The CRC is linear, so the CRC of a byte is the XOR of the CRCs of its two nibbles
+    crc ^= byte;
+    return nibble_tables.low[crc & 0x0F] ^ nibble_tables.high[crc >> 4];
+}
+
+uint8_t Crc8::update_bitwise(uint8_t crc, uint8_t byte) {
+    return calculate_bitwise(crc, byte);
+}
+
+uint8_t Crc8::update_bit(uint8_t crc, bool bit) {
+    bool feedback = (crc ^ bit) & 0x01;
+    crc >>= 1;
+    return feedback ? crc ^ 0x8C : crc;
+}
+
+uint8_t Crc8::calculate(const uint8_t* data, size_t length, uint8_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc = update(crc, data[i]);
+    }
+
+    return crc;
+}
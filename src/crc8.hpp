@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Contains functionality for calculating the Dallas/Maxim CRC8 (polynomial x^8 + x^5 + x^4 + 1) used by the
+ * Rom and the Scratchpad.
+ * update() uses a 256-byte lookup table generated at compile time (update_table). Defining DS18B20_CRC8_NIBBLE_TABLE
+ * makes it use two 16-byte lookup tables instead (update_nibble_tables: half the speed, 224 bytes less flash). The
+ * variant that update() does not use is removed by the linker unless it is called directly.
+ */
+class Crc8 {
+public:
+    static const size_t m_table_size = 256; ///< The size in bytes of the lookup table of update_table()
+
+    static const size_t m_nibble_tables_size = 32; ///< The size in bytes of the lookup tables of update_nibble_tables()
+
+    /**
+     * Calculates the new CRC value, taking the byte parameter into the CRC calculation.
+     * @param crc The current crc value: 0 if this is the first calculation, the previous crc value if not.
+     * @param byte The byte to include into the crc calculation.
+     * @return The updated crc value taking the byte parameter into account.
+     */
+    static uint8_t update(uint8_t crc, uint8_t byte);
+
+    /**
+     * Same as update(), with a lookup table of the CRC of each byte.
+     */
+    static uint8_t update_table(uint8_t crc, uint8_t byte);
+
+    /**
+     * Same as update(), with lookup tables of the CRC of each nibble.
+     */
+    static uint8_t update_nibble_tables(uint8_t crc, uint8_t byte);
+
+    /**
+     * Same as update(), calculated bit by bit without a lookup table.
+     */
+    static uint8_t update_bitwise(uint8_t crc, uint8_t byte);
+
+    /**
+     * Calculates the new CRC value, taking a single bit into the CRC calculation (for data that arrives bit by bit,
+     * e.g. a Rom during a search). Bits are taken LSB first.
+     * @param crc The current crc value.
+     * @param bit The bit to include into the crc calculation.
+     * @return The updated crc value.
+     */
+    static uint8_t update_bit(uint8_t crc, bool bit);
+
+    /**
+     * Calculates the CRC value of a block of bytes.
+     * @param data The bytes to include into the crc calculation.
+     * @param length The number of bytes.
+     * @param crc The initial crc value: 0 to start a new calculation, the previous crc value to continue one.
+     * @return The crc value of the bytes. Including the CRC code of a valid block in the calculation results in 0.
+     */
+    static uint8_t calculate(const uint8_t* data, size_t length, uint8_t crc = 0);
+};
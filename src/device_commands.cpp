@@ -2,168 +2,309 @@
 
 #include <stdio.h>
 #include <cstring>
-#include "pico/stdlib.h"
+#include "hal.hpp"
 
 #include "common.hpp"
+#include "crc8.hpp"
+
+namespace {
+    /**
+     * Fills data with the Match ROM command, followed by the family code, serial number and CRC code of the Rom.
+     */
+    void put_match_rom(uint8_t data[9], const Rom& rom) {
+        data[0] = static_cast<uint8_t>(RomCommands::MatchRom);
+        data[1] = rom.get_family_code();
+        for (int i = 0; i < 6; i++) {
+            data[i + 2] = rom.get_serial_number(i);
+        }
+        data[8] = rom.get_crc_code();
+    }
+
+    /**
+     * Checks a scratchpad read from a device.
+     * @param data The 9 bytes of the scratchpad.
+     * @param crc The CRC value of the 9 bytes (0 if they are valid).
+     */
+    CommandResult<Scratchpad> check_scratchpad(uint8_t data[9], uint8_t crc) {
+        Scratchpad scratchpad = Scratchpad(&data[0], data[2], data[3], data[4], &data[5], data[8]);
+
+        // Without a responding device, every byte is read as 0xFF
+        if (crc == 0) {
+            return scratchpad;
+        } else if (data[4] == 0xFF && data[8] == 0xFF) {
+            return CommandError::NoResponse;
+        } else {
+            return CommandError::CrcMismatch;
+        }
+    }
+}
 
 void DeviceCommands::skip_rom(const OneWire& one_wire) {
     uint8_t command = static_cast<uint8_t>(RomCommands::SkipRom);
     one_wire.write_byte(command);
 }
 
-std::optional<Rom> DeviceCommands::read_rom(const OneWire& one_wire) {
+CommandResult<Rom> DeviceCommands::read_rom(const OneWire& one_wire) {
     uint8_t command = static_cast<uint8_t>(RomCommands::ReadRom);
     one_wire.write_byte(command);
 
-    // Read the rom
-    uint8_t family_code = one_wire.read_byte();
-    uint8_t serial_number[6];
-    for (int i = 0; i < 6; i++) {
-        serial_number[i] = one_wire.read_byte();
-    }
-    uint8_t crc_code = one_wire.read_byte();
-    Rom rom(family_code, serial_number, crc_code);
+    // Read the rom (family code, serial number, CRC code)
+    // The CRC is calculated while the bytes arrive
+    uint8_t data[8];
+    one_wire.reset_crc();
+    one_wire.read_bytes(data, 8);
+    Rom rom(data[0], &data[1], data[7]);
 
     // Return the rom
-    if (!rom.is_empty() && rom.has_valid_crc()) {
-        return rom;
+    if (rom.is_empty()) {
+        return CommandError::NoResponse;
+    } else if (one_wire.get_crc() != 0) {
+        return CommandError::CrcMismatch;
     } else {
-        return std::nullopt;
+        return rom;
     }
 }
 
 void DeviceCommands::match_rom(const OneWire& one_wire, const Rom& rom) {
-    uint8_t command = static_cast<uint8_t>(RomCommands::MatchRom);
+    // Send the command, family code, serial number and CRC code in one block
+    uint8_t data[9];
+    put_match_rom(data, rom);
+    one_wire.write_bytes(data, 9);
+}
+
+void DeviceCommands::overdrive_skip_rom(OneWire& one_wire) {
+    uint8_t command = static_cast<uint8_t>(RomCommands::OverdriveSkipRom);
     one_wire.write_byte(command);
+    one_wire.set_speed(OneWireSpeed::Overdrive);
+}
 
-    // Send family code
-    one_wire.write_byte(rom.get_family_code());
+void DeviceCommands::overdrive_match_rom(OneWire& one_wire, const Rom& rom) {
+    // The command is sent at standard speed, the Rom at overdrive speed
+    uint8_t command = static_cast<uint8_t>(RomCommands::OverdriveMatchRom);
+    one_wire.write_byte(command);
+    one_wire.set_speed(OneWireSpeed::Overdrive);
 
-    // Send serial number
+    uint8_t data[8];
+    data[0] = rom.get_family_code();
     for (int i = 0; i < 6; i++) {
-        one_wire.write_byte(rom.get_serial_number(i));
+        data[i + 1] = rom.get_serial_number(i);
     }
-
-    // Send CRC code
-    one_wire.write_byte(rom.get_crc_code());
+    data[7] = rom.get_crc_code();
+    one_wire.write_bytes(data, 8);
 }
 
-std::optional<DeviceCommands::SearchInfo> DeviceCommands::search(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length) {
+CommandResult<DeviceCommands::SearchInfo> DeviceCommands::search(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length) {
     SearchInfo info = {};
     uint64_t new_sequence = 0;
+    uint8_t crc = 0;
     for (int i = 0; i < 64; i++) {
-        bool first_bit = one_wire.read_bit();
-        bool second_bit = one_wire.read_bit();
-        bool bit_choice;
-        if (!first_bit && second_bit) {
-            bit_choice = 0;
-        } else if (first_bit && !second_bit) {
-            bit_choice = 1;
-        } else if (!first_bit && !second_bit){
-            if (i < previous_sequence_length) {
-                bit_choice = (previous_sequence >> i) & 0b1;
-            } else if (i == previous_sequence_length) {
-                bit_choice = 1;
-            } else {
-                bit_choice = 0;
-                info.last_choice_path = new_sequence;
-                info.last_choice_path_size = i;
-            }
-        } else {
-            return std::nullopt;
+        // Where the devices differ, follow the previous path, take 1 at its last choice and 0 after it
+        bool direction = (i < previous_sequence_length) ? ((previous_sequence >> i) & 0b1) : (i == previous_sequence_length);
+        OneWireTriplet triplet = one_wire.triplet(direction);
+        if (triplet.id_bit && triplet.complement_bit) {
+            return CommandError::NoResponse;
         }
-        new_sequence |= ((uint64_t)bit_choice << i);
-        one_wire.write_bit(bit_choice);
+        if (!triplet.id_bit && !triplet.complement_bit && !triplet.direction) {
+            info.last_choice_path = new_sequence;
+            info.last_choice_path_size = i;
+        }
+
+        // The last byte is the CRC code, so each of its bits must match the CRC of the bits before it. A branch that
+        // doesn't is abandoned without issuing its remaining slots.
+        if (i >= 56 && triplet.direction != (crc & 0x01)) {
+            return CommandError::CrcMismatch;
+        }
+        crc = Crc8::update_bit(crc, triplet.direction);
+        new_sequence |= ((uint64_t)triplet.direction << i);
     }
 
     info.rom = Rom::decode_rom(new_sequence);
-    if (!info.rom.is_empty() && info.rom.has_valid_crc()) {
-        return info;
-    } else {
-        return std::nullopt;
+    if (info.rom.is_empty()) {
+        return CommandError::NoResponse;
     }
+
+    return info;
 }
 
-std::optional<DeviceCommands::SearchInfo> DeviceCommands::search_rom(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length) {
+CommandResult<DeviceCommands::SearchInfo> DeviceCommands::search_rom(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length) {
     uint8_t command = static_cast<uint8_t>(RomCommands::SearchRom);
     one_wire.write_byte(command);
 
     return search(one_wire, previous_sequence, previous_sequence_length);
 }
 
-std::optional<DeviceCommands::SearchInfo> DeviceCommands::search_alarm(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length) {
+CommandResult<DeviceCommands::SearchInfo> DeviceCommands::search_alarm(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length) {
     uint8_t command = static_cast<uint8_t>(RomCommands::SearchAlarm);
     one_wire.write_byte(command);
 
     return search(one_wire, previous_sequence, previous_sequence_length);
 }
 
-std::optional<uint32_t> DeviceCommands::convert_t(const OneWire& one_wire) {
-    uint8_t command = static_cast<uint8_t>(FunctionCommands::ConvertT);
-    one_wire.write_byte(command);
+uint32_t DeviceCommands::get_conversion_time_ms(Resolution resolution) {
+    switch (resolution) {
+        case Resolution::Low: {
+            return 94;
+        }
+        case Resolution::Medium: {
+            return 188;
+        }
+        case Resolution::High: {
+            return 375;
+        }
+        default: {
+            return 750;
+        }
+    }
+}
 
-    uint32_t start_time = to_ms_since_boot(get_absolute_time());
-    while (to_ms_since_boot(get_absolute_time()) - start_time < 1000) {
-        bool value = one_wire.read_bit();
-        if (value) {
-            return to_ms_since_boot(get_absolute_time()) - start_time;
+CommandResult<uint32_t> DeviceCommands::convert_t(const OneWire& one_wire, PowerSupplyMode power_supply_mode,
+        uint32_t expected_time_ms, uint32_t timeout_ms) {
+    start_convert_t(one_wire, power_supply_mode);
+    uint32_t start_time = Hal::get_time_ms();
+
+    // Leave the bus idle until the conversion is expected to be complete, but never past the timeout. Without the
+    // strong pull-up, the completion is first checked a little earlier, so that a faster conversion is noticed.
+    bool expected_after_timeout = expected_time_ms > timeout_ms;
+    uint32_t wait_time_ms = expected_after_timeout ? timeout_ms : expected_time_ms;
+    if (power_supply_mode == PowerSupplyMode::Parasite) {
+        Hal::sleep_ms(wait_time_ms);
+        one_wire.set_strong_pullup(false);
+        if (expected_after_timeout) {
+            return CommandError::Timeout;
+        }
+        return Hal::get_time_ms() - start_time;
+    }
+
+    // Check the completion at least once, even if the timeout has passed during the sleep. After the early check,
+    // wait for the expected time, then poll every millisecond.
+    Hal::sleep_ms(expected_after_timeout ? timeout_ms : expected_time_ms - expected_time_ms / 8);
+    while (true) {
+        if (is_conversion_complete(one_wire)) {
+            return Hal::get_time_ms() - start_time;
+        }
+        uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+        if (elapsed_time >= timeout_ms) {
+            return CommandError::Timeout;
         }
-        sleep_ms(5);
+        Hal::sleep_ms(elapsed_time < wait_time_ms ? wait_time_ms - elapsed_time : 1);
+    }
+}
+
+void DeviceCommands::start_convert_t(const OneWire& one_wire, PowerSupplyMode power_supply_mode) {
+    uint8_t command = static_cast<uint8_t>(FunctionCommands::ConvertT);
+    one_wire.write_byte(command);
+    if (power_supply_mode == PowerSupplyMode::Parasite) {
+        one_wire.set_strong_pullup(true);
     }
+}
 
-    return std::nullopt;
+bool DeviceCommands::is_conversion_complete(const OneWire& one_wire) {
+    return one_wire.read_bit();
 }
 
-std::optional<Scratchpad> DeviceCommands::read_scratchpad(const OneWire& one_wire) {
+CommandResult<Scratchpad> DeviceCommands::read_scratchpad(const OneWire& one_wire) {
     uint8_t command = static_cast<uint8_t>(FunctionCommands::ReadScratchpad);
     one_wire.write_byte(command);
 
-    // Read the scratchpad
-    uint8_t temperature[2];
-    for (int i = 0; i < 2; i++) {
-        temperature[i] = one_wire.read_byte();
-    }
-    uint8_t temperature_high_limit = one_wire.read_byte();
-    uint8_t temperature_low_limit = one_wire.read_byte();
-    uint8_t configuration = one_wire.read_byte();
-    uint8_t reserved[3];
-    for (int i = 0; i < 3; i++) {
-        reserved[i] = one_wire.read_byte();
-    }
-    uint8_t crc_code = one_wire.read_byte();
-    Scratchpad scratchpad = Scratchpad(temperature, temperature_high_limit, temperature_low_limit, configuration, reserved, crc_code);
+    // Read the scratchpad (temperature, limits, configuration, reserved, CRC code)
+    // The CRC is calculated while the bytes arrive
+    uint8_t data[9];
+    one_wire.reset_crc();
+    one_wire.read_bytes(data, 9);
 
-    // Check Scratchpad CRC
-    if (scratchpad.has_valid_crc()) {
-        return scratchpad;
-    } else {
-        return std::nullopt;
+    return check_scratchpad(data, one_wire.get_crc());
+}
+
+CommandResult<Scratchpad> DeviceCommands::read_scratchpad(const OneWire& one_wire, const Rom& rom) {
+    // Reset, Match ROM, Read Scratchpad and the 9 bytes of the scratchpad in a single transaction
+    uint8_t command[10];
+    put_match_rom(command, rom);
+    command[9] = static_cast<uint8_t>(FunctionCommands::ReadScratchpad);
+    uint8_t data[9];
+    if (!one_wire.transaction(command, 10, data, 9)) {
+        return CommandError::NoPresence;
     }
+
+    return check_scratchpad(data, one_wire.get_crc());
 }
 
-void DeviceCommands::write_scratchpad(const OneWire& one_wire, int8_t temperature_high, int8_t temperature_low, uint8_t configuration) {
-    uint8_t command = static_cast<uint8_t>(FunctionCommands::WriteScratchpad);
+bool DeviceCommands::start_read_scratchpad(const OneWire& one_wire, const Rom& rom, uint8_t data[9]) {
+    uint8_t command[10];
+    put_match_rom(command, rom);
+    command[9] = static_cast<uint8_t>(FunctionCommands::ReadScratchpad);
+
+    return one_wire.start_transaction(command, 10, data, 9);
+}
+
+CommandResult<Scratchpad> DeviceCommands::finish_read_scratchpad(const OneWire& one_wire, uint8_t data[9]) {
+    return check_scratchpad(data, one_wire.get_crc());
+}
+
+void DeviceCommands::read_scratchpad_prefix(const OneWire& one_wire, uint8_t* data, size_t length) {
+    uint8_t command = static_cast<uint8_t>(FunctionCommands::ReadScratchpad);
     one_wire.write_byte(command);
 
-    one_wire.write_byte(temperature_high);
-    one_wire.write_byte(temperature_low);
-    one_wire.write_byte(configuration);
+    one_wire.read_bytes(data, length);
+}
+
+bool DeviceCommands::read_scratchpad_prefix(const OneWire& one_wire, const Rom& rom, uint8_t* data, size_t length) {
+    uint8_t command[10];
+    put_match_rom(command, rom);
+    command[9] = static_cast<uint8_t>(FunctionCommands::ReadScratchpad);
+
+    return one_wire.transaction(command, 10, data, length);
 }
 
-std::optional<uint32_t> DeviceCommands::copy_scratchpad(const OneWire& one_wire) {
+void DeviceCommands::write_scratchpad(const OneWire& one_wire, int8_t temperature_high, int8_t temperature_low, uint8_t configuration) {
+    uint8_t data[4];
+    data[0] = static_cast<uint8_t>(FunctionCommands::WriteScratchpad);
+    data[1] = temperature_high;
+    data[2] = temperature_low;
+    data[3] = configuration;
+    one_wire.write_bytes(data, 4);
+}
+
+CommandResult<uint32_t> DeviceCommands::copy_scratchpad(const OneWire& one_wire, PowerSupplyMode power_supply_mode, uint32_t timeout_ms) {
     uint8_t command = static_cast<uint8_t>(FunctionCommands::CopyScratchpad);
     one_wire.write_byte(command);
+    if (power_supply_mode == PowerSupplyMode::Parasite) {
+        one_wire.set_strong_pullup(true);
+    }
+    uint32_t start_time = Hal::get_time_ms();
 
-    uint32_t start_time = to_ms_since_boot(get_absolute_time());
-    while (to_ms_since_boot(get_absolute_time()) - start_time < 1000) {
+    // Leave the bus idle until the writing is expected to be complete
+    Hal::sleep_ms(m_copy_scratchpad_time_ms);
+    if (power_supply_mode == PowerSupplyMode::Parasite) {
+        one_wire.set_strong_pullup(false);
+        return Hal::get_time_ms() - start_time;
+    }
+
+    // Check the completion at least once, even if the timeout has passed during the sleep
+    while (true) {
         bool value = one_wire.read_bit();
         if (value) {
-            return to_ms_since_boot(get_absolute_time()) - start_time;
+            return Hal::get_time_ms() - start_time;
+        }
+        if (Hal::get_time_ms() - start_time >= timeout_ms) {
+            return CommandError::Timeout;
+        }
+        Hal::sleep_ms(1);
+    }
+}
+
+bool DeviceCommands::recall_eeprom(const OneWire& one_wire) {
+    uint8_t command = static_cast<uint8_t>(FunctionCommands::RecallEeprom);
+    one_wire.write_byte(command);
+
+    // The device answers the read slots with 0 while the recall is in progress
+    uint32_t start_time = Hal::get_time_ms();
+    while (!one_wire.read_bit()) {
+        if (Hal::get_time_ms() - start_time >= m_recall_eeprom_timeout_ms) {
+            return false;
         }
-        sleep_ms(1);
     }
 
-    return std::nullopt;
+    return true;
 }
 
 PowerSupplyMode DeviceCommands::read_power_supply_mode(const OneWire& one_wire) {
@@ -2,17 +2,35 @@
 
 #include <optional>
 
+#include "command_result.hpp"
 #include "rom.hpp"
 #include "scratchpad.hpp"
 #include "one_wire.hpp"
+#include "retry_policy.hpp"
 
 enum class PowerSupplyMode { Parasite, External };
 
+/// How an enumeration of the devices of a bus ended
+enum class SearchStatus {
+    Complete, ///< Every device was found
+    NoPresence, ///< No device answered the reset pulse, so the search was aborted
+    SearchFailed, ///< A search step failed (e.g. the Rom had an invalid CRC code), so the search was aborted
+    StorageFull ///< The storage of the devices was full, so the remaining devices were not searched
+};
+
 /**
  * Contains all ds18b20 rom/function commands.
  */
 class DeviceCommands {
 public:
+    static const uint32_t m_max_conversion_time_ms = 750; ///< The maximum time a temperature measurement takes (12-bit resolution)
+
+    static const uint32_t m_copy_scratchpad_time_ms = 10; ///< The maximum time a write of the scratchpad to the EEPROM takes
+
+    static const uint32_t m_recall_eeprom_timeout_ms = 10; ///< The time after which a recall of the EEPROM is considered failed
+
+    static const uint32_t m_conversion_timeout_ms = 1000; ///< The default time after which a measurement or EEPROM write is considered failed
+
     /// The return type for search commands (search_rom, search_alarm)
     struct SearchInfo {
         Rom rom;
@@ -27,9 +45,9 @@ private:
      * @param previous_sequence The path of the previous search that led to a choice. 0 if no other searches have been conducted.
      * @param previous_sequence_length The length of the path of the previous search that led to a choice. 0 if no other searches have been conducted.
      * @return If the search was successful, a Rom, the path just before the last choice and that path's length are returned.
-     * If the search failed, std::nullopt is returned.
+     * If the search failed, the error is returned (NoResponse if no device answered, CrcMismatch if the Rom is invalid).
      */
-    static std::optional<SearchInfo> search(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length);
+    static CommandResult<SearchInfo> search(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length);
 
 public:
     // ROM commands
@@ -46,24 +64,37 @@ public:
      * Only works when only 1 ds18b20 is connected on the same data pin (when it is the only device using
      * this specific OneWire object).
      * @param one_wire A reference to a OneWire object to act upon.
-     * @return The Rom object that was just read.
+     * @return The Rom object that was just read. If the read failed, the error is returned (NoResponse or CrcMismatch).
      */
-    static std::optional<Rom> read_rom(const OneWire& one_wire);
+    static CommandResult<Rom> read_rom(const OneWire& one_wire);
 
     /**
      * Selects the Rom of this device as the Rom to act upon on the next function command.
      */
     static void match_rom(const OneWire& one_wire, const Rom& rom);
 
+    /**
+     * Same as skip_rom, but also switches all devices that support overdrive speed (and the OneWire object) to
+     * overdrive speed. Devices that do not support it must not be used until a reset at standard speed
+     * (OneWire::set_speed(OneWireSpeed::Standard) followed by a reset).
+     */
+    static void overdrive_skip_rom(OneWire& one_wire);
+
+    /**
+     * Same as match_rom, but also switches the selected device (and the OneWire object) to overdrive speed.
+     * The Rom is sent at overdrive speed. The device stays at overdrive speed until a reset at standard speed.
+     */
+    static void overdrive_match_rom(OneWire& one_wire, const Rom& rom);
+
     /**
      * Conducts a search for a matching Rom.
      * @param one_wire A reference to a OneWire object to act upon.
      * @param previous_sequence The path of the previous search that led to a choice. 0 if no other searches have been conducted.
      * @param previous_sequence_length The length of the path of the previous search that led to a choice. 0 if no other searches have been conducted.
      * @return If the search was successful, a Rom, the path just before the last choice and that path's length are returned.
-     * If the search failed, std::nullopt is returned.
+     * If the search failed, the error is returned (NoResponse if no device answered, CrcMismatch if the Rom is invalid).
      */
-    static std::optional<SearchInfo> search_rom(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length);
+    static CommandResult<SearchInfo> search_rom(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length);
 
     /**
      * Conducts a search for a matching Rom which has its alarm flag raised.
@@ -71,24 +102,148 @@ public:
      * @param previous_sequence The path of the previous search that led to a choice. 0 if no other searches have been conducted.
      * @param previous_sequence_length The length of the path of the previous search that led to a choice. 0 if no other searches have been conducted.
      * @return If the search was successful, a Rom, the path just before the last choice and that path's length are returned.
-     * If the search failed, std::nullopt is returned.
+     * If the search failed, the error is returned (NoResponse if no device answered, CrcMismatch if the Rom is invalid).
      */
-    static std::optional<SearchInfo> search_alarm(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length);
+    static CommandResult<SearchInfo> search_alarm(const OneWire& one_wire, uint64_t previous_sequence, int previous_sequence_length);
+
+    /**
+     * Enumerates the devices that answer Search ROM (all devices) or Search Alarm (the devices whose alarm flag is
+     * raised), one search per device, each starting with a reset. The reset and the search are retried together
+     * according to retry_policy.
+     * @param one_wire A reference to a OneWire object to act upon.
+     * @param alarm Whether to search with Search Alarm instead of Search ROM.
+     * @param retry_policy The retry policy of each search.
+     * @param on_rom Called with the Rom of each device found, as `bool on_rom(const Rom& rom)`. Returns false to stop
+     * before the next device, e.g. when the storage of the devices is full.
+     * @return How the enumeration ended (StorageFull if on_rom stopped it). Search Alarm ends with Complete when no
+     * device answers, as there are no alarming devices left.
+     */
+    template <typename Callback>
+    static SearchStatus search_devices(const OneWire& one_wire, bool alarm, const RetryPolicy& retry_policy, Callback on_rom) {
+        SearchInfo info{};
+        info.last_choice_path_size = -2;
+        while (info.last_choice_path_size != -1) {
+            // Grab a Rom
+            bool presence = false;
+            CommandResult<SearchInfo> result = CommandError::NoResponse;
+            Retry retry(retry_policy);
+            while (retry.next()) {
+                if (!one_wire.reset()) {
+                    continue;
+                }
+                presence = true;
+                result = alarm ? search_alarm(one_wire, info.last_choice_path, info.last_choice_path_size)
+                    : search_rom(one_wire, info.last_choice_path, info.last_choice_path_size);
+                if (!result.has_value() && !(alarm && result.get_error() == CommandError::NoResponse)) {
+                    continue;
+                }
+                break;
+            }
+            if (!presence) {
+                return SearchStatus::NoPresence;
+            }
+            if (!result.has_value()) {
+                return alarm && result.get_error() == CommandError::NoResponse ? SearchStatus::Complete : SearchStatus::SearchFailed;
+            }
+            info = result.value();
+
+            if (!on_rom(info.rom) && info.last_choice_path_size != -1) {
+                return SearchStatus::StorageFull;
+            }
+        }
+
+        return SearchStatus::Complete;
+    }
 
     // Function commands
 
     /**
-     * Conducts a temperature measurement on the selected device.
+     * @param resolution The resolution of the measurement.
+     * @return The maximum time a temperature measurement takes at the given resolution, in milliseconds
+     * (94, 188, 375 or 750).
+     */
+    static uint32_t get_conversion_time_ms(Resolution resolution);
+
+    /**
+     * Conducts a temperature measurement on the selected device. The bus is left idle until shortly before
+     * expected_time_ms (7/8 of it), when the completion is checked once. If it has not completed yet, the bus is left
+     * idle until expected_time_ms, then polled every millisecond until timeout_ms. In parasite power mode, the bus is held high with the strong pull-up for expected_time_ms
+     * instead (devices in parasite power mode cannot signal the completion). The call never waits much longer than
+     * timeout_ms: if expected_time_ms is longer, the completion is checked once at timeout_ms (in parasite power mode,
+     * the measurement fails).
+     * @param power_supply_mode The power supply mode of the selected device(s).
+     * @param expected_time_ms The time the measurement is expected to take. In parasite power mode, it must be at
+     * least the conversion time of the resolution of the device(s) (see get_conversion_time_ms).
+     * @param timeout_ms The time after which the measurement is considered failed.
      * @return If the measurement is successful, the time it took in milliseconds is returned.
-     * If the measurement failed, std::nullopt is returned.
+     * If the measurement failed, CommandError::Timeout is returned.
      */
-    static std::optional<uint32_t> convert_t(const OneWire& one_wire);
+    static CommandResult<uint32_t> convert_t(const OneWire& one_wire, PowerSupplyMode power_supply_mode = PowerSupplyMode::External,
+        uint32_t expected_time_ms = m_max_conversion_time_ms, uint32_t timeout_ms = m_conversion_timeout_ms);
 
     /**
-     * Reads the scratchpad of the selected device and stores it into the Rom object of this device.
-     * @return True if the read was successful, false if not.
+     * Requests a temperature measurement on the selected device without waiting for it to complete.
+     * Use is_conversion_complete to find out when the measurement is done. In parasite power mode, the strong
+     * pull-up is enabled and must be disabled (OneWire::set_strong_pullup) once the conversion time has passed.
+     * @param power_supply_mode The power supply mode of the selected device(s).
      */
-    static std::optional<Scratchpad> read_scratchpad(const OneWire& one_wire);
+    static void start_convert_t(const OneWire& one_wire, PowerSupplyMode power_supply_mode = PowerSupplyMode::External);
+
+    /**
+     * Checks if the temperature measurement started with start_convert_t has completed. The bus must not
+     * be used by any other command between start_convert_t and this call.
+     * @return True if the measurement has completed, false if it is still in progress.
+     */
+    static bool is_conversion_complete(const OneWire& one_wire);
+
+    /**
+     * Reads the scratchpad of the selected device.
+     * @return If the read was successful, the scratchpad is returned. If not, CommandError::CrcMismatch is returned
+     * (or CommandError::NoResponse if every byte was read as 0xFF).
+     */
+    static CommandResult<Scratchpad> read_scratchpad(const OneWire& one_wire);
+
+    /**
+     * Resets the bus, selects the device with the given Rom and reads its scratchpad, as a single transaction (see
+     * OneWire::transaction).
+     * @return If the read was successful, the scratchpad is returned. If not, CommandError::NoPresence is returned if
+     * no device responded to the reset, CommandError::NoResponse if every byte was read as 0xFF and
+     * CommandError::CrcMismatch otherwise.
+     */
+    static CommandResult<Scratchpad> read_scratchpad(const OneWire& one_wire, const Rom& rom);
+
+    /**
+     * Same as read_scratchpad(one_wire, rom), but returns after the reset (see OneWire::start_transaction). Once
+     * OneWire::is_transaction_complete() returns true, finish_read_scratchpad() checks the bytes read.
+     * @param data The buffer to store the 9 bytes of the scratchpad. Must stay valid until the transaction is complete.
+     * @return True if a device responded to the reset, false if not (no bytes are transferred).
+     */
+    static bool start_read_scratchpad(const OneWire& one_wire, const Rom& rom, uint8_t data[9]);
+
+    /**
+     * Checks the scratchpad read by start_read_scratchpad(), after the transaction is complete.
+     * @param data The buffer passed to start_read_scratchpad().
+     * @return If the read was successful, the scratchpad is returned. If not, CommandError::NoResponse is returned if
+     * every byte was read as 0xFF and CommandError::CrcMismatch otherwise.
+     */
+    static CommandResult<Scratchpad> finish_read_scratchpad(const OneWire& one_wire, uint8_t data[9]);
+
+    /**
+     * Reads only the first bytes of the scratchpad of the selected device. The CRC code cannot be checked, and
+     * the read has to be aborted with a reset afterwards.
+     * @param data The buffer to store the bytes that were read.
+     * @param length The number of bytes to read (at most 9).
+     */
+    static void read_scratchpad_prefix(const OneWire& one_wire, uint8_t* data, size_t length);
+
+    /**
+     * Resets the bus, selects the device with the given Rom and reads the first bytes of its scratchpad, as a single
+     * transaction (see OneWire::transaction). The read has to be aborted with a reset afterwards.
+     * @param data The buffer to store the bytes that were read.
+     * @param length The number of bytes to read (at most 9).
+     * @return True if a device responded to the reset, false if not.
+     */
+    static bool read_scratchpad_prefix(const OneWire& one_wire, const Rom& rom, uint8_t* data, size_t length);
 
     /**
      * Overwrites the scratchpad with the parameter values.
@@ -99,11 +254,22 @@ public:
     static void write_scratchpad(const OneWire& one_wire, int8_t temperature_high, int8_t temperature_low, uint8_t configuration);
 
     /**
-     * Writes the scratchpad to the EEPROM.
+     * Writes the scratchpad to the EEPROM. The bus is left idle for the maximum write time before the completion
+     * is checked. In parasite power mode, the bus is held high with the strong pull-up for that time instead.
+     * @param power_supply_mode The power supply mode of the selected device(s).
+     * @param timeout_ms The time after which the writing is considered failed.
      * @return If the writing is successful, the time it took in milliseconds is returned.
-     * If the writing failed, std::nullopt is returned.
+     * If the writing failed, CommandError::Timeout is returned.
+     */
+    static CommandResult<uint32_t> copy_scratchpad(const OneWire& one_wire, PowerSupplyMode power_supply_mode = PowerSupplyMode::External,
+        uint32_t timeout_ms = m_conversion_timeout_ms);
+
+    /**
+     * Copies the limits and the configuration from the EEPROM to the scratchpad of the selected device, as done at
+     * power-on, and waits for the recall to complete.
+     * @return True if the recall completed, false if it did not within m_recall_eeprom_timeout_ms.
      */
-    static std::optional<uint32_t> copy_scratchpad(const OneWire& one_wire);
+    static bool recall_eeprom(const OneWire& one_wire);
 
     /**
      * Fetches the power supply mode of the selected device.
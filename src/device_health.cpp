@@ -0,0 +1,73 @@
+#include "device_health.hpp"
+
+void DeviceHealth::record_error(CommandError error) {
+    switch (error) {
+        case CommandError::NoPresence: {
+            m_counters.presence_failures++;
+            break;
+        }
+        case CommandError::NoResponse: {
+            m_counters.no_responses++;
+            break;
+        }
+        case CommandError::CrcMismatch: {
+            m_counters.crc_failures++;
+            break;
+        }
+        case CommandError::Timeout: {
+            m_counters.timeouts++;
+            break;
+        }
+        case CommandError::InvalidData: {
+            m_counters.invalid_data++;
+            break;
+        }
+        default: {
+            return;
+        }
+    }
+    m_counters.retries++;
+
+    m_score -= (m_score + 7) / 8;
+}
+
+void DeviceHealth::record_operation(bool success) {
+    if (success) {
+        m_counters.successful_operations++;
+        m_score += (m_max_score - m_score + 3) / 4;
+    } else {
+        m_counters.failed_operations++;
+    }
+}
+
+bool DeviceHealth::should_attempt() {
+    if (!is_quarantined()) {
+        m_skipped_operations = 0;
+        return true;
+    }
+
+    // Probe the device once in a while
+    m_skipped_operations++;
+    if (m_skipped_operations >= m_probe_interval) {
+        m_skipped_operations = 0;
+        return true;
+    }
+
+    return false;
+}
+
+uint8_t DeviceHealth::get_score() const {
+    return m_score;
+}
+
+bool DeviceHealth::is_quarantined() const {
+    return m_score < m_quarantine_score;
+}
+
+const DeviceErrorCounters& DeviceHealth::get_counters() const {
+    return m_counters;
+}
+
+void DeviceHealth::clear() {
+    *this = DeviceHealth();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "command_result.hpp"
+
+/// The errors of a device since the creation or the last clear() call
+struct DeviceErrorCounters {
+    uint32_t presence_failures = 0; ///< Attempts where no device answered the reset pulse
+    uint32_t no_responses = 0; ///< Attempts where the device did not answer after being selected
+    uint32_t crc_failures = 0; ///< Attempts where the data was received with an invalid CRC code
+    uint32_t timeouts = 0; ///< Attempts where the device did not complete a conversion or EEPROM write in time
+    uint32_t invalid_data = 0; ///< Attempts where an implausible temperature was read (out of range or power-on value)
+    uint32_t retries = 0; ///< Attempts that failed for any of the reasons above (each is retried unless it was the last one)
+    uint32_t failed_operations = 0; ///< Operations that failed after all attempts
+    uint32_t successful_operations = 0; ///< Operations that succeeded (possibly after retries)
+};
+
+/**
+ * Tracks the errors of a device and derives a health score from them. Every failed attempt lowers the score by
+ * an eighth, every successful operation raises it by a quarter of the way back to the maximum. A device whose score
+ * falls below m_quarantine_score is quarantined: its operations are skipped (without using the bus), except
+ * for one probe every m_probe_interval operations, so that it can recover when it works again.
+ */
+class DeviceHealth {
+public:
+    static const uint8_t m_max_score = 100; ///< The score of a device without recent errors
+
+    static const uint8_t m_quarantine_score = 25; ///< The score below which a device is quarantined
+
+    static const uint8_t m_probe_interval = 8; ///< A quarantined device is attempted once every this many operations
+
+private:
+    DeviceErrorCounters m_counters; ///< The errors since the creation or the last clear() call
+
+    uint8_t m_score = m_max_score; ///< The current health score
+
+    uint8_t m_skipped_operations = 0; ///< The operations skipped since the quarantined device was last probed
+
+public:
+    /**
+     * Records a failed attempt.
+     * @param error The reason the attempt failed.
+     */
+    void record_error(CommandError error);
+
+    /**
+     * Records the outcome of an operation (after all of its attempts).
+     * @param success Whether the operation succeeded.
+     */
+    void record_operation(bool success);
+
+    /**
+     * Decides whether the next operation should use the bus. Always true unless the device is quarantined, in
+     * which case it is true once every m_probe_interval calls.
+     * @return True if the operation should be attempted, false if it should be skipped.
+     */
+    bool should_attempt();
+
+    /**
+     * @return The health score, from 0 (every recent attempt failed) to m_max_score.
+     */
+    uint8_t get_score() const;
+
+    /**
+     * @return True if the score is below m_quarantine_score, false if not.
+     */
+    bool is_quarantined() const;
+
+    /**
+     * @return The errors since the creation or the last clear() call.
+     */
+    const DeviceErrorCounters& get_counters() const;
+
+    /**
+     * Resets the counters and the score.
+     */
+    void clear();
+};
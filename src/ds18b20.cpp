@@ -1,22 +1,23 @@
 #include "ds18b20.hpp"
 
 #include <stdio.h>
+#include "hal.hpp"
 
-Ds18b20::Ds18b20(OneWire& one_wire, Rom rom) : m_one_wire(one_wire) {
+Ds18b20::Ds18b20(OneWire& one_wire, Rom rom, const RetryPolicies& retry_policies) : m_one_wire(one_wire) {
     m_rom = rom;
+    m_retry_policies = &retry_policies;
 
     // Read the scratchpad
     bool ok = false;
-    for (int t = 0; t < m_max_tries; t++) {
-        if (!m_one_wire.reset()) {
-            continue;
-        }
-        DeviceCommands::match_rom(m_one_wire, m_rom);
-        std::optional scratchpad = DeviceCommands::read_scratchpad(m_one_wire);
+    Retry retry(get_retry_policy(RetryOperation::Read));
+    while (retry.next()) {
+        CommandResult<Scratchpad> scratchpad = DeviceCommands::read_scratchpad(m_one_wire, m_rom);
         if (scratchpad.has_value()) {
             m_scratchpad = scratchpad.value();
             ok = true;
+            break;
         } else {
+            m_health.record_error(scratchpad.get_error());
             continue;
         }
     }
@@ -24,76 +25,166 @@ Ds18b20::Ds18b20(OneWire& one_wire, Rom rom) : m_one_wire(one_wire) {
         return;
     }
 
-    // Check that power supply is external
+    // Read the power supply mode
     std::optional<PowerSupplyMode> power_supply_mode = get_power_supply_mode();
-    if ((power_supply_mode.has_value() && power_supply_mode.value() == PowerSupplyMode::Parasite)
-            || !power_supply_mode.has_value()){
+    if (!power_supply_mode.has_value()) {
         return;
     }
+    m_power_supply_mode = power_supply_mode.value();
+    m_conversion_time_ms = DeviceCommands::get_conversion_time_ms(get_resolution());
 
     is_initialized = true;
 }
 
+Ds18b20::Ds18b20(OneWire& one_wire, Rom rom, PowerSupplyMode power_supply_mode) : m_one_wire(one_wire) {
+    m_rom = rom;
+    m_power_supply_mode = power_supply_mode;
+}
+
+bool Ds18b20::restore(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration) {
+    uint8_t data[5];
+    if (!read_scratchpad_prefix(data)) {
+        return false;
+    }
+    if ((int8_t)data[2] != temperature_high_limit || (int8_t)data[3] != temperature_low_limit || data[4] != configuration) {
+        return false;
+    }
+
+    // The reserved bytes and the CRC code were not read, they are not used afterwards
+    uint8_t reserved[3] = { 0xFF, 0x00, 0x10 };
+    m_scratchpad = Scratchpad(data, temperature_high_limit, temperature_low_limit, configuration, reserved, 0);
+    m_conversion_time_ms = DeviceCommands::get_conversion_time_ms(get_resolution());
+    is_initialized = true;
+
+    return true;
+}
+
 bool Ds18b20::is_successfully_initialized() const {
     return is_initialized;
 }
 
-etl::vector<Ds18b20, 10> Ds18b20::find_devices(OneWire& one_wire) {
-    etl::vector<Ds18b20, 10> devices;
-    DeviceCommands::SearchInfo info{};
-    info.last_choice_path_size = -2;
-    while (info.last_choice_path_size != -1) {
-        // Reset
-        bool ok = false;
-        for (int t = 0; t < m_max_tries; t++) {
-            if (!one_wire.reset()) {
-                continue;
-            }
+const Rom& Ds18b20::get_rom() const {
+    return m_rom;
+}
 
-            ok = true;
-            break;
+SearchStatus Ds18b20::search_devices(OneWire& one_wire, const etl::ivector<Ds18b20>* known_devices, etl::ivector<Ds18b20>& devices,
+        const RetryPolicies& retry_policies) {
+    devices.clear();
+    if (devices.full()) {
+        return SearchStatus::StorageFull;
+    }
+
+    return DeviceCommands::search_devices(one_wire, false, retry_policies.get(RetryOperation::Ping), [&](const Rom& rom) {
+        // Reuse the device if it is already known
+        const Ds18b20* known_device = nullptr;
+        if (known_devices != nullptr) {
+            for (size_t i = 0; i < known_devices->size(); i++) {
+                if ((*known_devices)[i].get_rom() == rom) {
+                    known_device = &(*known_devices)[i];
+                    break;
+                }
+            }
         }
-        
-        // Grab a ROM
-        std::optional<DeviceCommands::SearchInfo> result = DeviceCommands::search_rom(one_wire, info.last_choice_path, info.last_choice_path_size);
-        if (result.has_value()) {
-            info = result.value();
-            Ds18b20 device(one_wire, info.rom);
+        if (known_device != nullptr) {
+            devices.emplace_back(*known_device);
+        } else {
+            Ds18b20 device(one_wire, rom, retry_policies);
             if (device.is_successfully_initialized()) {
                 devices.emplace_back(device);
             }
-        } else {
-            break;
         }
-    }
 
-    printf("Found %d devices\n", devices.size());
+        return !devices.full();
+    });
+}
+
+etl::vector<Ds18b20, 10> Ds18b20::find_devices(OneWire& one_wire, const RetryPolicies& retry_policies) {
+    etl::vector<Ds18b20, 10> devices;
+    search_devices(one_wire, nullptr, devices, retry_policies);
+
+    printf("Found %d devices\n", (int)devices.size());
     
     return devices;
 }
 
-bool Ds18b20::ping() const {
-    bool ok = false;
-    for (int t = 0; t < m_max_tries; t++) {
-        // Read the rom to see if it matches
-        uint64_t rom = Rom::encode_rom(m_rom);
-        if (!m_one_wire.reset()) {
+SearchStatus Ds18b20::find_devices(OneWire& one_wire, etl::ivector<Ds18b20>& devices, const RetryPolicies& retry_policies) {
+    SearchStatus status = search_devices(one_wire, nullptr, devices, retry_policies);
+
+    printf("Found %d devices\n", (int)devices.size());
+
+    return status;
+}
+
+etl::vector<Ds18b20, 10> Ds18b20::find_devices(OneWire& one_wire, const etl::ivector<Ds18b20>& known_devices,
+        const RetryPolicies& retry_policies) {
+    etl::vector<Ds18b20, 10> devices;
+    search_devices(one_wire, &known_devices, devices, retry_policies);
+
+    printf("Found %d devices\n", (int)devices.size());
+    
+    return devices;
+}
+
+SearchStatus Ds18b20::find_devices(OneWire& one_wire, const etl::ivector<Ds18b20>& known_devices, etl::ivector<Ds18b20>& devices,
+        const RetryPolicies& retry_policies) {
+    SearchStatus status = search_devices(one_wire, &known_devices, devices, retry_policies);
+
+    printf("Found %d devices\n", (int)devices.size());
+
+    return status;
+}
+
+bool Ds18b20::select() const {
+    if (!m_one_wire.reset()) {
+        m_health.record_error(CommandError::NoPresence);
+        return false;
+    }
+    DeviceCommands::match_rom(m_one_wire, m_rom);
+
+    return true;
+}
+
+bool Ds18b20::is_present() const {
+    uint8_t data[5];
+    return read_scratchpad_prefix(data);
+}
+
+bool Ds18b20::read_scratchpad_prefix(uint8_t data[5]) const {
+    Retry retry(get_retry_policy(RetryOperation::Ping));
+    while (retry.next()) {
+        // Read the temperature, the limits and the configuration, then abort the read
+        if (!DeviceCommands::read_scratchpad_prefix(m_one_wire, m_rom, data, 5)) {
+            m_health.record_error(CommandError::NoPresence);
             continue;
         }
-        std::optional<DeviceCommands::SearchInfo> result = DeviceCommands::search_rom(m_one_wire, rom, 64);
-        if (result.has_value()) {
-            DeviceCommands::SearchInfo info = result.value();
-            if (info.rom != m_rom) {
-                continue;
-            }
-        } else {
+        m_one_wire.reset();
+
+        // Without a responding device, every byte is read as 0xFF. The configuration byte always has its
+        // MSB cleared and its 5 LSBs set.
+        uint8_t configuration = data[4];
+        if ((configuration & 0b10011111) != 0b00011111) {
+            m_health.record_error(CommandError::NoResponse);
             continue;
         }
 
-        // Check that power supply is external
+        return true;
+    }
+
+    return false;
+}
+
+bool Ds18b20::ping() const {
+    // Check that the device responds
+    if (!is_present()) {
+        return false;
+    }
+
+    bool ok = false;
+    Retry retry(get_retry_policy(RetryOperation::Ping));
+    while (retry.next()) {
+        // Check that the power supply mode has not changed
         std::optional<PowerSupplyMode> power_supply_mode = get_power_supply_mode();
-        if ((power_supply_mode.has_value() && power_supply_mode.value() == PowerSupplyMode::Parasite)
-             || !power_supply_mode.has_value()){
+        if (!power_supply_mode.has_value() || power_supply_mode.value() != m_power_supply_mode) {
             continue;
         }
 
@@ -105,49 +196,279 @@ bool Ds18b20::ping() const {
 }
 
 std::optional<float> Ds18b20::measure_temperature() {
+    if (!measure_temperature_raw().has_value()) {
+        return std::nullopt;
+    }
+
+    return m_scratchpad.calculate_temperature();
+}
+
+std::optional<int16_t> Ds18b20::measure_temperature_raw() {
+    Sample sample = measure_sample();
+    if (!sample.valid) {
+        return std::nullopt;
+    }
+
+    return sample.temperature;
+}
+
+Sample Ds18b20::measure_sample() {
+    Sample sample;
+    sample.rom = Rom::encode_rom(m_rom);
+
+    // Quarantined devices are only probed once in a while
+    if (!m_health.should_attempt()) {
+        return sample;
+    }
+
     // Request a temperature measurement
     bool ok = false;
-    for (int t = 0; t < m_max_tries; t++) {
-        if (!m_one_wire.reset()) {
+    Retry retry(get_retry_policy(RetryOperation::Measure));
+    while (retry.next()) {
+        if (!select()) {
+            sample.retries++;
             continue;
         }
-        DeviceCommands::match_rom(m_one_wire, m_rom);
-        if (!DeviceCommands::convert_t(m_one_wire).has_value()) {
+        sample.conversion_start_us = Hal::get_time_us();
+        uint32_t timeout = m_conversion_timeout_ms;
+        if (retry.get_remaining_us() / 1000 < timeout) {
+            timeout = retry.get_remaining_us() / 1000;
+        }
+        CommandResult<uint32_t> time = DeviceCommands::convert_t(m_one_wire, m_power_supply_mode,
+            get_expected_conversion_time_ms(), timeout);
+        if (!time.has_value()) {
+            m_health.record_error(time.get_error());
+            sample.retries++;
             continue;
         }
+        sample.conversion_end_us = Hal::get_time_us();
+        learn_conversion_time(time.value());
 
         ok = true;
         break;
     }
+
+    // Read the temperature
+    if (ok && read_measurement(sample.retries, sample.crc_failures)) {
+        sample.timestamp_us = Hal::get_time_us();
+        sample.read_latency_us = sample.timestamp_us - sample.conversion_end_us;
+        sample.temperature = m_scratchpad.get_raw_temperature();
+        sample.valid = true;
+    }
+    m_health.record_operation(sample.valid);
+    m_sample_statistics.add(sample);
+
+    return sample;
+}
+
+const SampleStatistics& Ds18b20::get_sample_statistics() const {
+    return m_sample_statistics;
+}
+
+void Ds18b20::clear_sample_statistics() {
+    m_sample_statistics.clear();
+}
+
+std::optional<float> Ds18b20::read_temperature() {
+    if (!read_temperature_raw().has_value()) {
+        return std::nullopt;
+    }
+
+    return m_scratchpad.calculate_temperature();
+}
+
+std::optional<int16_t> Ds18b20::read_temperature_raw() {
+    // Quarantined devices are only probed once in a while
+    if (!m_health.should_attempt()) {
+        return std::nullopt;
+    }
+
+    uint8_t retries = 0;
+    uint8_t crc_failures = 0;
+    bool ok = read_measurement(retries, crc_failures);
+    m_health.record_operation(ok);
     if (!ok) {
         return std::nullopt;
     }
 
-    // Read the scratchpad
-    ok = false;
-    for (int t = 0; t < m_max_tries; t++) {
-        if (!m_one_wire.reset()) {
-            continue;
-        }
-        DeviceCommands::match_rom(m_one_wire, m_rom);
-        std::optional scratchpad = DeviceCommands::read_scratchpad(m_one_wire);
-        if (scratchpad.has_value()) {
-            m_scratchpad = scratchpad.value();
+    // Extract the temperature from the scratchpad
+    return m_scratchpad.get_raw_temperature();
+}
+
+bool Ds18b20::read_measurement(uint8_t& retries, uint8_t& crc_failures) {
+    // The limits and the configuration are cached, so only the temperature is needed, except for the periodic
+    // full reads that verify the CRC code
+    bool fast_read = m_fast_read && m_reads_since_full_read < m_full_read_interval;
+
+    bool ok = false;
+    Retry retry(get_retry_policy(RetryOperation::Read));
+    while (retry.next()) {
+        if (fast_read) {
+            // Read the temperature, the limits and the configuration, then abort the read
+            uint8_t data[5];
+            if (!DeviceCommands::read_scratchpad_prefix(m_one_wire, m_rom, data, 5)) {
+                m_health.record_error(CommandError::NoPresence);
+                retries++;
+                continue;
+            }
+            m_one_wire.reset();
+
+            // Without a CRC code, a missing device (all bytes 0xFF) or a corrupted read is detected by comparing the
+            // limits and the configuration with the cached ones, and the temperature with the range of the device.
+            // Fall back to a full read to find out.
+            int16_t temperature = data[0] + (data[1] << 8);
+            if ((int8_t)data[2] != m_scratchpad.get_temperature_high_limit() ||
+                    (int8_t)data[3] != m_scratchpad.get_temperature_low_limit() ||
+                    data[4] != m_scratchpad.get_configuration() ||
+                    temperature < m_min_raw_temperature || temperature > m_max_raw_temperature) {
+                m_health.record_error(CommandError::InvalidData);
+                retries++;
+                fast_read = false;
+                continue;
+            }
+            m_scratchpad.set_temperature_bytes(data);
+            m_reads_since_full_read++;
         } else {
-            continue;
+            CommandResult<Scratchpad> scratchpad = DeviceCommands::read_scratchpad(m_one_wire, m_rom);
+            if (!scratchpad.has_value()) {
+                m_health.record_error(scratchpad.get_error());
+                retries++;
+                if (scratchpad.get_error() == CommandError::CrcMismatch) {
+                    crc_failures++;
+                }
+                continue;
+            }
+            m_scratchpad = scratchpad.value();
+            m_reads_since_full_read = 0;
         }
 
         ok = true;
         break;
     }
     if (!ok) {
+        return false;
+    }
+
+    // The temperature register holds 85 degrees after power-on. Reading it after a conversion means that the device
+    // was probably reset during the conversion, unless the previous measurement was close to 85 degrees (then
+    // it is accepted). A device stuck at 85 degrees is accepted from the second measurement on.
+    int16_t temperature = m_scratchpad.get_raw_temperature();
+    bool power_on_value = temperature == m_power_on_raw_temperature && (!m_has_last_raw_temperature ||
+        m_last_raw_temperature < m_power_on_raw_temperature - m_power_on_margin ||
+        m_last_raw_temperature > m_power_on_raw_temperature + m_power_on_margin);
+    m_last_raw_temperature = temperature;
+    m_has_last_raw_temperature = true;
+    if (power_on_value) {
+        m_health.record_error(CommandError::InvalidData);
+        retries++;
+        return false;
+    }
+
+    return true;
+}
+
+bool Ds18b20::start_conversion() {
+    Retry retry(get_retry_policy(RetryOperation::Measure));
+    while (retry.next()) {
+        if (!select()) {
+            continue;
+        }
+        DeviceCommands::start_convert_t(m_one_wire, m_power_supply_mode);
+
+        m_conversion_start_ms = Hal::get_time_ms();
+        m_conversion_state = ConversionState::Converting;
+        return true;
+    }
+
+    m_conversion_state = ConversionState::Failed;
+    return false;
+}
+
+ConversionState Ds18b20::poll() {
+    if (m_conversion_state != ConversionState::Converting) {
+        return m_conversion_state;
+    }
+
+    // Leave the bus idle until the conversion may be complete (the same early check as DeviceCommands::convert_t)
+    uint32_t elapsed_time = Hal::get_time_ms() - m_conversion_start_ms;
+    uint32_t check_time = get_expected_conversion_time_ms();
+    if (m_power_supply_mode != PowerSupplyMode::Parasite) {
+        check_time -= check_time / 8;
+    }
+    if (elapsed_time < check_time) {
+        return m_conversion_state;
+    }
+
+    if (m_power_supply_mode == PowerSupplyMode::Parasite) {
+        // The device cannot signal the completion, the expected time is the maximum conversion time
+        m_one_wire.set_strong_pullup(false);
+    } else {
+        // Check if the conversion has completed
+        if (!DeviceCommands::is_conversion_complete(m_one_wire)) {
+            if (elapsed_time >= m_conversion_timeout_ms) {
+                m_health.record_error(CommandError::Timeout);
+                m_health.record_operation(false);
+                m_conversion_state = ConversionState::Failed;
+            }
+            return m_conversion_state;
+        }
+        learn_conversion_time(elapsed_time);
+    }
+
+    // Read the result
+    if (read_temperature_raw().has_value()) {
+        m_conversion_state = ConversionState::Ready;
+    } else {
+        m_conversion_state = ConversionState::Failed;
+    }
+
+    return m_conversion_state;
+}
+
+bool Ds18b20::result_ready() const {
+    return m_conversion_state == ConversionState::Ready;
+}
+
+std::optional<float> Ds18b20::get_result() const {
+    if (!result_ready()) {
         return std::nullopt;
     }
 
-    // Extract the temperature from the scratchpad
     return m_scratchpad.calculate_temperature();
 }
 
+std::optional<int16_t> Ds18b20::get_result_raw() const {
+    if (!result_ready()) {
+        return std::nullopt;
+    }
+
+    return m_scratchpad.get_raw_temperature();
+}
+
+uint32_t Ds18b20::get_expected_conversion_time_ms() const {
+    if (m_power_supply_mode == PowerSupplyMode::Parasite) {
+        return DeviceCommands::get_conversion_time_ms(get_resolution());
+    }
+
+    return m_conversion_time_ms;
+}
+
+void Ds18b20::learn_conversion_time(uint32_t time_ms) {
+    if (m_power_supply_mode == PowerSupplyMode::Parasite) {
+        return;
+    }
+
+    m_conversion_time_ms = (3 * m_conversion_time_ms + time_ms) / 4;
+}
+
+uint32_t Ds18b20::get_conversion_time_ms() const {
+    return m_conversion_time_ms;
+}
+
+void Ds18b20::set_conversion_timeout_ms(uint32_t timeout_ms) {
+    m_conversion_timeout_ms = timeout_ms;
+}
+
 Resolution Ds18b20::get_resolution() const {
     switch (m_scratchpad.get_resolution()) {
         case 9: {
@@ -172,26 +493,63 @@ Resolution Ds18b20::get_resolution() const {
     }
 }
 
+bool Ds18b20::has_settings(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration) const {
+    return m_scratchpad.get_temperature_high_limit() == temperature_high_limit &&
+        m_scratchpad.get_temperature_low_limit() == temperature_low_limit &&
+        m_scratchpad.get_configuration() == configuration;
+}
+
 bool Ds18b20::set_scratchpad(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration, bool save) {
-    // Write the new values to the scratchpad and read it again
+    // Only write the settings if the device does not have them already
+    if (has_settings(temperature_high_limit, temperature_low_limit, configuration)) {
+        m_configuration_statistics.scratchpad_writes_avoided++;
+    } else {
+        m_configuration_statistics.scratchpad_writes++;
+        if (!write_scratchpad(temperature_high_limit, temperature_low_limit, configuration)) {
+            m_health.record_operation(false);
+            return false;
+        }
+        m_is_saved = false;
+    }
+
+    // Only save the scratchpad if the EEPROM does not have the same settings already
+    if (save && m_is_saved) {
+        m_configuration_statistics.eeprom_writes_avoided++;
+    } else if (save) {
+        m_configuration_statistics.eeprom_writes++;
+        if (!copy_scratchpad()) {
+            m_health.record_operation(false);
+            return false;
+        }
+    }
+
+    m_health.record_operation(true);
+    return true;
+}
+
+bool Ds18b20::write_scratchpad(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration) {
+    Resolution previous_resolution = get_resolution();
+
+    // Write the new values to the scratchpad and read it again, to check that the device received them
     bool ok = false;
-    for (int t = 0; t < m_max_tries; t++) {
+    Retry retry(get_retry_policy(RetryOperation::Configure));
+    while (retry.next()) {
         // Write to the scratchpad
-        if (!m_one_wire.reset()) {
+        if (!select()) {
             continue;
         }
-        DeviceCommands::match_rom(m_one_wire, m_rom);
         DeviceCommands::write_scratchpad(m_one_wire, temperature_high_limit, temperature_low_limit, configuration);
 
         // Read the scratchpad
-        if (!m_one_wire.reset()) {
-            continue;
-        }
-        DeviceCommands::match_rom(m_one_wire, m_rom);
-        std::optional scratchpad = DeviceCommands::read_scratchpad(m_one_wire);
+        CommandResult<Scratchpad> scratchpad = DeviceCommands::read_scratchpad(m_one_wire, m_rom);
         if (scratchpad.has_value()) {
             m_scratchpad = scratchpad.value();
         } else {
+            m_health.record_error(scratchpad.get_error());
+            continue;
+        }
+        if (!has_settings(temperature_high_limit, temperature_low_limit, configuration)) {
+            m_health.record_error(CommandError::InvalidData);
             continue;
         }
     
@@ -202,29 +560,74 @@ bool Ds18b20::set_scratchpad(int8_t temperature_high_limit, int8_t temperature_l
         return false;
     }
 
-    // Save the scratchpad if specified
-    if (save) {
-        bool ok = false;
-        for (int t = 0; t < m_max_tries; t++) {
-            if (!m_one_wire.reset()) {
-                continue;
-            }
-            DeviceCommands::match_rom(m_one_wire, m_rom);
-            if (!DeviceCommands::copy_scratchpad(m_one_wire).has_value()) {
-                continue;
-            }
+    // The learned conversion time does not apply to another resolution
+    if (get_resolution() != previous_resolution) {
+        m_conversion_time_ms = DeviceCommands::get_conversion_time_ms(get_resolution());
+    }
 
-            ok = true;
-            break;
-        }
-        if (!ok) {
-            return false;
+    return true;
+}
+
+bool Ds18b20::reload_scratchpad() {
+    Resolution previous_resolution = get_resolution();
+
+    bool ok = false;
+    Retry retry(get_retry_policy(RetryOperation::Read));
+    while (retry.next()) {
+        CommandResult<Scratchpad> scratchpad = DeviceCommands::read_scratchpad(m_one_wire, m_rom);
+        if (!scratchpad.has_value()) {
+            m_health.record_error(scratchpad.get_error());
+            continue;
         }
+        m_scratchpad = scratchpad.value();
+
+        ok = true;
+        break;
+    }
+    if (!ok) {
+        return false;
+    }
+
+    // The learned conversion time does not apply to another resolution
+    if (get_resolution() != previous_resolution) {
+        m_conversion_time_ms = DeviceCommands::get_conversion_time_ms(get_resolution());
     }
 
     return true;
 }
 
+bool Ds18b20::copy_scratchpad() {
+    Retry retry(get_retry_policy(RetryOperation::Configure));
+    while (retry.next()) {
+        if (!select()) {
+            continue;
+        }
+        CommandResult<uint32_t> time = DeviceCommands::copy_scratchpad(m_one_wire, m_power_supply_mode);
+        if (!time.has_value()) {
+            m_health.record_error(time.get_error());
+            continue;
+        }
+
+        m_is_saved = true;
+        return true;
+    }
+
+    return false;
+}
+
+Ds18b20Configuration Ds18b20::get_configuration() const {
+    return Ds18b20Configuration(get_resolution(), get_temperature_high_limit(), get_temperature_low_limit());
+}
+
+bool Ds18b20::configure(const Ds18b20Configuration& configuration, bool save) {
+    return set_scratchpad(configuration.get_temperature_high_limit(), configuration.get_temperature_low_limit(),
+        configuration.get_configuration_byte(), save);
+}
+
+const ConfigurationStatistics& Ds18b20::get_configuration_statistics() const {
+    return m_configuration_statistics;
+}
+
 bool Ds18b20::set_resolution(Resolution resolution, bool save) {
     uint8_t configuration = m_scratchpad.resolution_to_configuration(resolution);
     return set_scratchpad(m_scratchpad.get_temperature_high_limit(), m_scratchpad.get_temperature_low_limit(), configuration, save);
@@ -247,12 +650,14 @@ bool Ds18b20::set_temperature_high_limit(int8_t temperature, bool save) {
 }
 
 bool Ds18b20::is_alarm_active() const {
-    for (int t = 0; t < m_max_tries; t++) {
+    Retry retry(get_retry_policy(RetryOperation::Alarm));
+    while (retry.next()) {
         uint64_t rom = Rom::encode_rom(m_rom);
         if (!m_one_wire.reset()) {
+            m_health.record_error(CommandError::NoPresence);
             continue;
         }
-        std::optional<DeviceCommands::SearchInfo> result = DeviceCommands::search_alarm(m_one_wire, rom, 64);
+        CommandResult<DeviceCommands::SearchInfo> result = DeviceCommands::search_alarm(m_one_wire, rom, 64);
         if (result.has_value()) {
             DeviceCommands::SearchInfo info = result.value();
             if (info.rom == m_rom) {
@@ -260,7 +665,11 @@ bool Ds18b20::is_alarm_active() const {
             } else {
                 return false;
             }
+        } else if (result.get_error() == CommandError::NoResponse) {
+            // No device has its alarm flag raised
+            return false;
         } else {
+            m_health.record_error(result.get_error());
             continue;
         }
     }
@@ -270,8 +679,9 @@ bool Ds18b20::is_alarm_active() const {
 
 std::optional<PowerSupplyMode> Ds18b20::get_power_supply_mode() const {
     bool ok = false;
-    for (int t = 0; t < m_max_tries; t++) {
-        if (!m_one_wire.reset()) {
+    Retry retry(get_retry_policy(RetryOperation::PowerSupply));
+    while (retry.next()) {
+        if (!select()) {
             continue;
         }
 
@@ -282,6 +692,35 @@ std::optional<PowerSupplyMode> Ds18b20::get_power_supply_mode() const {
         return std::nullopt;
     }
 
-    DeviceCommands::match_rom(m_one_wire, m_rom);
     return DeviceCommands::read_power_supply_mode(m_one_wire);
 }
+
+uint8_t Ds18b20::get_health_score() const {
+    return m_health.get_score();
+}
+
+bool Ds18b20::is_quarantined() const {
+    return m_health.is_quarantined();
+}
+
+const DeviceErrorCounters& Ds18b20::get_error_counters() const {
+    return m_health.get_counters();
+}
+
+void Ds18b20::clear_error_counters() {
+    m_health.clear();
+}
+
+const RetryPolicy& Ds18b20::get_retry_policy(RetryOperation operation) const {
+    return m_retry_policies->get(operation);
+}
+
+void Ds18b20::set_retry_policies(const RetryPolicies& policies) {
+    m_retry_policies = &policies;
+}
+
+void Ds18b20::set_fast_read(bool enabled, uint8_t full_read_interval) {
+    m_fast_read = enabled;
+    m_full_read_interval = full_read_interval;
+    m_reads_since_full_read = 0;
+}
@@ -1,9 +1,16 @@
 #pragma once
 
 #include "device_commands.hpp"
+#include "device_health.hpp"
+#include "ds18b20_configuration.hpp"
+#include "retry_policy.hpp"
+#include "sample_statistics.hpp"
+#include "temperature.hpp"
 
 #include "etl/vector.h"
 
+enum class ConversionState { Idle, Converting, Ready, Failed };
+
 /**
  * Contains the functionality of a ds18b20 device.
  */
@@ -16,11 +23,69 @@ private:
     Scratchpad m_scratchpad; ///< The scratchpad of the device
 
     bool is_initialized = false; ///< The state of the device after initialization (constructor called).
-    
-    static const int m_max_tries = 10; ///< The maximum amount of tries before a command fails (indicates device failure).
+
+    PowerSupplyMode m_power_supply_mode = PowerSupplyMode::External; ///< The power supply mode read on initialization.
+
+    const RetryPolicies* m_retry_policies = &RetryPolicies::get_default(); ///< How the operations are retried when they fail.
+
+    ConversionState m_conversion_state = ConversionState::Idle; ///< The state of the non-blocking temperature measurement.
+
+    uint32_t m_conversion_start_ms = 0; ///< The time (ms since boot) at which the non-blocking measurement was started.
+
+    uint32_t m_conversion_timeout_ms = DeviceCommands::m_conversion_timeout_ms; ///< The time after which a measurement is considered failed.
+
+    uint32_t m_conversion_time_ms = DeviceCommands::m_max_conversion_time_ms; ///< The conversion time learned from previous measurements.
+
+    static const int16_t m_power_on_raw_temperature = 85 * 16; ///< The temperature register after power-on (85 degrees)
+
+    static const int16_t m_power_on_margin = 2 * 16; ///< How close to 85 degrees the previous measurement must be to accept 85 degrees
+
+    static const int16_t m_min_raw_temperature = -55 * 16; ///< The lowest temperature the device can measure
+
+    static const int16_t m_max_raw_temperature = 125 * 16; ///< The highest temperature the device can measure
+
+    int16_t m_last_raw_temperature = 0; ///< The temperature of the previous measurement, even if it was rejected
+
+    bool m_has_last_raw_temperature = false; ///< Whether m_last_raw_temperature was set
+
+    bool m_fast_read = false; ///< Whether only the temperature bytes of the scratchpad are read (see set_fast_read)
+
+    uint8_t m_full_read_interval = 16; ///< In fast read mode, the number of fast reads between two full reads
+
+    uint8_t m_reads_since_full_read = 0; ///< The number of fast reads since the last full read
+
+    bool m_is_saved = false; ///< Whether the EEPROM is known to have the same settings as the scratchpad (unknown until the first save)
+
+    SampleStatistics m_sample_statistics; ///< The statistics of the samples measured with measure_sample().
+
+    mutable DeviceHealth m_health; ///< The errors of the device and its health score.
+
+    ConfigurationStatistics m_configuration_statistics; ///< The scratchpad and EEPROM writes of the device
+
+    /**
+     * @return The retry policy of the given operation.
+     */
+    const RetryPolicy& get_retry_policy(RetryOperation operation) const;
+
+    /**
+     * Resets the bus and selects the device (Match ROM). Records a presence failure if no device answered.
+     * @return True if the device was selected, false if not.
+     */
+    bool select() const;
+
+    /**
+     * Reads the result of a conversion into m_scratchpad, with a full read (checked with the CRC code) or, in fast
+     * read mode, by reading only the temperature bytes. Rejects the power-on value of 85 degrees (see DS18B20 datasheet)
+     * if the previous measurement was not close to it.
+     * @param retries Incremented for each failed attempt.
+     * @param crc_failures Incremented for each read rejected because of an invalid CRC.
+     * @return True if the read was successful, false if not.
+     */
+    bool read_measurement(uint8_t& retries, uint8_t& crc_failures);
 
     /**
-     * Overwrites the scratchpad with the parameter values. Also saves it to the EEPROM if specified.
+     * Overwrites the scratchpad with the parameter values. Also saves it to the EEPROM if specified. The scratchpad
+     * is only written if its cached settings differ, and the EEPROM only if it does not have the settings already.
      * @param temperature_high_limit The upper temperature limit for triggering the alarm.
      * @param temperature_low_limit The lower temperature limit for triggering the alarm.
      * @param configuration Byte containing 2-bits indicating the resolution of the measurements.
@@ -29,12 +94,90 @@ private:
      */
     bool set_scratchpad(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration, bool save);
 
+    /**
+     * @return True if the cached scratchpad has the given settings, false if not.
+     */
+    bool has_settings(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration) const;
+
+    /**
+     * Writes the scratchpad and reads it back into m_scratchpad.
+     * @return True if the writing was successful, false if not.
+     */
+    bool write_scratchpad(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration);
+
+    /**
+     * Reads the scratchpad into m_scratchpad again (after it was written by Ds18b20Bus::configure_all).
+     * @return True if the read was successful, false if not.
+     */
+    bool reload_scratchpad();
+
+    /**
+     * Copies the scratchpad to the EEPROM.
+     * @return True if the writing was successful, false if not.
+     */
+    bool copy_scratchpad();
+
+    friend class Ds18b20Bus;
+
+    friend class RomCache;
+
+    /**
+     * Creates a Ds18b20 object from cached data, without using the bus. It is not initialized until restore() succeeds.
+     * @param power_supply_mode The power supply mode read when the device was initialized.
+     */
+    Ds18b20(OneWire& one_wire, Rom rom, PowerSupplyMode power_supply_mode);
+
+    /**
+     * Selects the device and reads the first 5 bytes of its scratchpad (temperature, limits and configuration).
+     * @param data The buffer to store the bytes read.
+     * @return True if the device responded, false if not.
+     */
+    bool read_scratchpad_prefix(uint8_t data[5]) const;
+
+    /**
+     * Initializes a device created from cached data with a single read of its scratchpad prefix.
+     * @param temperature_high_limit The cached upper temperature limit.
+     * @param temperature_low_limit The cached lower temperature limit.
+     * @param configuration The cached configuration byte.
+     * @return True if the device responded with the cached settings, false if not.
+     */
+    bool restore(int8_t temperature_high_limit, int8_t temperature_low_limit, uint8_t configuration);
+
+    /**
+     * @return The time a measurement is expected to take. In parasite power mode, it is the maximum conversion time
+     * of the resolution. Otherwise, it is the learned conversion time, and the completion is first checked slightly
+     * earlier (see DeviceCommands::convert_t), so that the learned time can also decrease.
+     */
+    uint32_t get_expected_conversion_time_ms() const;
+
+    /**
+     * Updates the learned conversion time with the duration of a measurement (moving average).
+     * @param time_ms The time the measurement took.
+     */
+    void learn_conversion_time(uint32_t time_ms);
+
+    /**
+     * Enumerates the devices connected on the GPIO pin specified in the OneWire object.
+     * @param one_wire The OneWire object to act upon.
+     * @param known_devices Devices found by a previous enumeration, which are reused without reading their scratchpad
+     * and power supply mode again. nullptr to initialize every device found.
+     * @param devices Filled with the devices found.
+     * @param retry_policies How the search steps (Ping policy) and the initialization of the new devices are retried.
+     * Given to the new devices (see set_retry_policies).
+     * @return How the search ended. The devices found before it was aborted are kept.
+     */
+    static SearchStatus search_devices(OneWire& one_wire, const etl::ivector<Ds18b20>* known_devices, etl::ivector<Ds18b20>& devices,
+        const RetryPolicies& retry_policies);
+
 public:
     /**
-     * Creates a Ds18b20 object configured to the specified OneWire and Rom., and reads its scratchpad. If the read
-     * is successful is_initialized is set to true, if not, it is set to false.
+     * Creates a Ds18b20 object configured to the specified OneWire and Rom, and reads its scratchpad. If the read is
+     * successful is_initialized is set to true, if not, it is set to false. Whether the EEPROM has the same settings
+     * as the scratchpad is not known, so the first save copies the scratchpad to the EEPROM.
+     * @param retry_policies How the operations of the device are retried when they fail (see set_retry_policies).
+     * Must outlive the device.
      */
-    Ds18b20(OneWire& one_wire, Rom rom);
+    Ds18b20(OneWire& one_wire, Rom rom, const RetryPolicies& retry_policies = RetryPolicies::get_default());
 
     /**
      * @return True if the device initialized correctly, false if not.
@@ -42,8 +185,20 @@ public:
     bool is_successfully_initialized() const;
 
     /**
-     * Pings the device to check if it is operational. This is done by reading its Rom and seeing if it matches
-     * with the one it was initialized with.
+     * @return The Rom of the device.
+     */
+    const Rom& get_rom() const;
+
+    /**
+     * Checks if the device responds when addressed, by selecting it and reading the first bytes of its scratchpad.
+     * This is much cheaper than a Search ROM.
+     * @return True if the device responded, false if not.
+     */
+    bool is_present() const;
+
+    /**
+     * Pings the device to check if it is operational. This is done by selecting its Rom and checking that it
+     * responds (see is_present), and that its power supply mode has not changed since initialization.
      * @return True if the device is operational, false if not.
      */
     bool ping() const;
@@ -55,6 +210,89 @@ public:
      */
     std::optional<float> measure_temperature();
 
+    /**
+     * Conducts a temperature measurement on the device and records when it was captured. The sample is also
+     * added to the statistics of the device (see get_sample_statistics).
+     * @return The measurement, with its timestamps, retries and CRC failures. Its valid flag is false if it failed.
+     */
+    Sample measure_sample();
+
+    /**
+     * @return The statistics of the samples measured so far (latency and jitter). Does not use the bus.
+     */
+    const SampleStatistics& get_sample_statistics() const;
+
+    /**
+     * Resets the statistics of the samples.
+     */
+    void clear_sample_statistics();
+
+    /**
+     * Same as measure_temperature(), without floating point arithmetic.
+     * @return If the measurement was successful, the temperature of the measurement is returned in 1/16 degree
+     * steps (see Temperature::from_raw). If it failed, std::nullopt is returned.
+     */
+    std::optional<int16_t> measure_temperature_raw();
+
+    /**
+     * Reads the scratchpad of the device and extracts the temperature of the last conversion, without
+     * requesting a new one. Used after a conversion was triggered on all devices at once (see Ds18b20Bus).
+     * @return If the read was successful, the temperature of the last measurement is returned. If it
+     * failed, std::nullopt is returned.
+     */
+    std::optional<float> read_temperature();
+
+    /**
+     * Same as read_temperature(), without floating point arithmetic.
+     * @return If the read was successful, the temperature of the last measurement is returned in 1/16 degree
+     * steps. If it failed, std::nullopt is returned.
+     */
+    std::optional<int16_t> read_temperature_raw();
+
+    /**
+     * Requests a temperature measurement on the device without waiting for it to complete. Call poll()
+     * periodically to advance the measurement. The bus must not be used by any other command until
+     * the measurement has completed (in parasite power mode, the strong pull-up holds the bus until then).
+     * @return True if the measurement was started, false if not.
+     */
+    bool start_conversion();
+
+    /**
+     * Advances the non-blocking temperature measurement. Checks (with a single read slot, or by time in parasite
+     * power mode) whether the conversion has completed, and if so, reads the scratchpad of the device.
+     * @return The state of the measurement after this call.
+     */
+    ConversionState poll();
+
+    /**
+     * @return True if the non-blocking temperature measurement has completed successfully, false if not.
+     */
+    bool result_ready() const;
+
+    /**
+     * @return If the non-blocking temperature measurement has completed successfully, its temperature is
+     * returned. If not, std::nullopt is returned.
+     */
+    std::optional<float> get_result() const;
+
+    /**
+     * @return If the non-blocking temperature measurement has completed successfully, its temperature is
+     * returned in 1/16 degree steps. If not, std::nullopt is returned.
+     */
+    std::optional<int16_t> get_result_raw() const;
+
+    /**
+     * @return The conversion time of the device learned from previous measurements, in milliseconds. It starts from
+     * the maximum conversion time of the resolution (see DeviceCommands::get_conversion_time_ms).
+     */
+    uint32_t get_conversion_time_ms() const;
+
+    /**
+     * Sets the time after which a measurement is considered failed.
+     * @param timeout_ms The timeout in milliseconds (1000 by default).
+     */
+    void set_conversion_timeout_ms(uint32_t timeout_ms);
+
     /**
      * @return The resolution of the temperature measurements.
      */
@@ -67,6 +305,26 @@ public:
      */
     bool set_resolution(Resolution resolution, bool save);
 
+    /**
+     * @return The current settings of the device, to be changed and applied with configure().
+     */
+    Ds18b20Configuration get_configuration() const;
+
+    /**
+     * Applies several settings at once. The scratchpad is written only if the settings differ from the current ones,
+     * and the EEPROM only if it does not have them already, so a batch of changes costs at most one scratchpad
+     * write and one EEPROM write.
+     * @param configuration The settings to apply (see get_configuration).
+     * @param save Whether to also save the settings to the EEPROM.
+     * @return True if the writing was successful, false if not.
+     */
+    bool configure(const Ds18b20Configuration& configuration, bool save);
+
+    /**
+     * @return The scratchpad and EEPROM writes of the device, and the ones avoided because the device already had the settings.
+     */
+    const ConfigurationStatistics& get_configuration_statistics() const;
+
     /**
      * @return The lower temperature limit for triggering the alarm.
      */
@@ -91,7 +349,8 @@ public:
 
     /**
      * Checks if the temperature alarm flag is raised. if it is raised, it means that the last measured temperature
-     * was out of bounds (out of the specified limits).
+     * was out of bounds (out of the specified limits). Costs a full Search Alarm per call; to check the alarms of
+     * many devices, use Ds18b20Bus::scan_alarms or Ds18b20RegistryBase::scan_alarms instead.
      * @return True if the last temperature was out of the specified limits, false if not.
      */
     bool is_alarm_active() const;
@@ -103,11 +362,88 @@ public:
      */
     std::optional<PowerSupplyMode> get_power_supply_mode() const;
 
+    /**
+     * Enables or disables the fast read mode. In fast read mode, measurements only read the first 5 bytes of the
+     * scratchpad (40 read slots instead of 72) and abort the read with a reset. As these bytes have no CRC code, the
+     * limits and the configuration read are compared with the cached ones, which detects a missing device and most
+     * corrupted reads. Every full_read_interval-th read is a full read (checked with the CRC code), and mismatching or
+     * implausible reads are read again with a full read.
+     * @param enabled Whether to use the fast read mode.
+     * @param full_read_interval The number of fast reads between two full reads.
+     */
+    void set_fast_read(bool enabled, uint8_t full_read_interval = 16);
+
+    /**
+     * Sets how the operations of the device are retried when they fail. The same policies can be shared by all
+     * devices of a bus. By default, every operation is attempted up to 10 times without backoff or deadline.
+     * @param policies The retry policy of each operation. Must outlive the device.
+     */
+    void set_retry_policies(const RetryPolicies& policies);
+
+    /**
+     * @return The health score of the device, from 0 (every recent attempt failed) to DeviceHealth::m_max_score.
+     */
+    uint8_t get_health_score() const;
+
+    /**
+     * A device is quarantined when its health score is too low. The measurements of a quarantined device are
+     * skipped without using the bus (they fail immediately), except for one probe every DeviceHealth::m_probe_interval
+     * measurements, until a successful probe raises the score again.
+     * @return True if the device is quarantined, false if not.
+     */
+    bool is_quarantined() const;
+
+    /**
+     * @return The presence failures, CRC failures, timeouts and retries of the device.
+     */
+    const DeviceErrorCounters& get_error_counters() const;
+
+    /**
+     * Resets the error counters and the health score.
+     */
+    void clear_error_counters();
+
     /**
      * Scans the GPIO pin specified in the OneWire object for connected devices. There can be more than one in a specific GPIO,
      * so a vector of Ds18b20 is returned instead.
      * @param one_wire The OneWire object to act upon.
+     * @param retry_policies How the search and the devices found are retried (see set_retry_policies). Must outlive
+     * the devices.
+     * @return A vector with all Ds18b20 devices connected on the GPIO pin specified in OneWire object.
+     */
+    static etl::vector<Ds18b20, 10> find_devices(OneWire& one_wire, const RetryPolicies& retry_policies = RetryPolicies::get_default());
+
+    /**
+     * Same as find_devices(one_wire), but stores the devices in caller-provided storage of any capacity.
+     * If more devices are connected than the capacity of the storage, the search stops when it is full.
+     * @param one_wire The OneWire object to act upon.
+     * @param devices Filled with all Ds18b20 devices connected on the GPIO pin specified in OneWire object.
+     * @param retry_policies How the search and the devices found are retried.
+     * @return How the search ended (StorageFull if it stopped because devices was full).
+     */
+    static SearchStatus find_devices(OneWire& one_wire, etl::ivector<Ds18b20>& devices,
+        const RetryPolicies& retry_policies = RetryPolicies::get_default());
+
+    /**
+     * Same as find_devices(one_wire), but reuses the devices of a previous enumeration: devices that are still
+     * connected are kept as they are (without reading their scratchpad and power supply mode again), devices
+     * that are no longer connected are dropped and new devices are initialized.
+     * @param one_wire The OneWire object to act upon.
+     * @param known_devices The devices returned by a previous enumeration of the same GPIO pin.
+     * @param retry_policies How the search and the new devices are retried.
      * @return A vector with all Ds18b20 devices connected on the GPIO pin specified in OneWire object.
      */
-    static etl::vector<Ds18b20, 10> find_devices(OneWire& one_wire);
+    static etl::vector<Ds18b20, 10> find_devices(OneWire& one_wire, const etl::ivector<Ds18b20>& known_devices,
+        const RetryPolicies& retry_policies = RetryPolicies::get_default());
+
+    /**
+     * Same as find_devices(one_wire, known_devices), but stores the devices in caller-provided storage of any capacity.
+     * @param one_wire The OneWire object to act upon.
+     * @param known_devices The devices returned by a previous enumeration of the same GPIO pin. Must not be devices.
+     * @param devices Filled with all Ds18b20 devices connected on the GPIO pin specified in OneWire object.
+     * @param retry_policies How the search and the new devices are retried.
+     * @return How the search ended (StorageFull if it stopped because devices was full).
+     */
+    static SearchStatus find_devices(OneWire& one_wire, const etl::ivector<Ds18b20>& known_devices, etl::ivector<Ds18b20>& devices,
+        const RetryPolicies& retry_policies = RetryPolicies::get_default());
 };
@@ -0,0 +1,206 @@
+#include "ds18b20_bus.hpp"
+
+Ds18b20Bus::Ds18b20Bus(OneWire& one_wire, const RetryPolicies& retry_policies) : m_one_wire(one_wire), m_retry_policies(retry_policies) {
+
+}
+
+std::optional<PowerSupplyMode> Ds18b20Bus::get_power_supply_mode() {
+    if (m_power_supply_mode.has_value()) {
+        return m_power_supply_mode;
+    }
+
+    Retry retry(m_retry_policies.get(RetryOperation::PowerSupply));
+    while (retry.next()) {
+        if (!m_one_wire.reset()) {
+            continue;
+        }
+        DeviceCommands::skip_rom(m_one_wire);
+        m_power_supply_mode = DeviceCommands::read_power_supply_mode(m_one_wire);
+        return m_power_supply_mode;
+    }
+
+    return std::nullopt;
+}
+
+void Ds18b20Bus::set_power_supply_mode(std::optional<PowerSupplyMode> power_supply_mode) {
+    m_power_supply_mode = power_supply_mode;
+}
+
+bool Ds18b20Bus::convert_all(Resolution resolution) {
+    std::optional<PowerSupplyMode> power_supply_mode = get_power_supply_mode();
+    if (!power_supply_mode.has_value()) {
+        return false;
+    }
+
+    Retry retry(m_retry_policies.get(RetryOperation::Measure));
+    while (retry.next()) {
+        if (!m_one_wire.reset()) {
+            continue;
+        }
+        DeviceCommands::skip_rom(m_one_wire);
+        uint32_t conversion_time = DeviceCommands::get_conversion_time_ms(resolution);
+        uint32_t timeout = DeviceCommands::m_conversion_timeout_ms;
+        if (retry.get_remaining_us() / 1000 < timeout) {
+            timeout = retry.get_remaining_us() / 1000;
+        }
+        if (!DeviceCommands::convert_t(m_one_wire, power_supply_mode.value(), conversion_time, timeout).has_value()) {
+            continue;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool Ds18b20Bus::configure_all(etl::ivector<Ds18b20>& devices, const Ds18b20Configuration& configuration, bool save) {
+    int8_t temperature_high_limit = configuration.get_temperature_high_limit();
+    int8_t temperature_low_limit = configuration.get_temperature_low_limit();
+    uint8_t configuration_byte = configuration.get_configuration_byte();
+
+    // Find out which writes are needed
+    bool write = false;
+    bool copy = false;
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (!devices[i].has_settings(temperature_high_limit, temperature_low_limit, configuration_byte)) {
+            write = true;
+        } else if (!devices[i].m_is_saved) {
+            copy = true;
+        }
+    }
+    copy = save && (write || copy);
+    bool all_configured = true;
+
+    // Write the scratchpad of all devices at once, then read each one back to verify it
+    if (write) {
+        bool ok = false;
+        Retry retry(m_retry_policies.get(RetryOperation::Configure));
+        while (retry.next()) {
+            if (!m_one_wire.reset()) {
+                continue;
+            }
+            DeviceCommands::skip_rom(m_one_wire);
+            DeviceCommands::write_scratchpad(m_one_wire, temperature_high_limit, temperature_low_limit, configuration_byte);
+
+            ok = true;
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+
+        for (size_t i = 0; i < devices.size(); i++) {
+            Ds18b20& device = devices[i];
+            if (device.has_settings(temperature_high_limit, temperature_low_limit, configuration_byte)) {
+                device.m_configuration_statistics.scratchpad_writes_avoided++;
+            } else {
+                device.m_configuration_statistics.scratchpad_writes++;
+                device.m_is_saved = false;
+            }
+            if (!device.reload_scratchpad() || !device.has_settings(temperature_high_limit, temperature_low_limit, configuration_byte)) {
+                all_configured = false;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i].m_configuration_statistics.scratchpad_writes_avoided++;
+        }
+    }
+
+    // Copy the scratchpad of all devices to the EEPROM at once
+    if (copy) {
+        std::optional<PowerSupplyMode> power_supply_mode = get_power_supply_mode();
+        if (!power_supply_mode.has_value()) {
+            return false;
+        }
+
+        bool ok = false;
+        Retry retry(m_retry_policies.get(RetryOperation::Configure));
+        while (retry.next()) {
+            if (!m_one_wire.reset()) {
+                continue;
+            }
+            DeviceCommands::skip_rom(m_one_wire);
+            if (!DeviceCommands::copy_scratchpad(m_one_wire, power_supply_mode.value()).has_value()) {
+                continue;
+            }
+
+            ok = true;
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (save) {
+        // The copy reaches the EEPROM of every device
+        for (size_t i = 0; i < devices.size(); i++) {
+            Ds18b20& device = devices[i];
+            if (copy) {
+                device.m_configuration_statistics.eeprom_writes++;
+            } else {
+                device.m_configuration_statistics.eeprom_writes_avoided++;
+            }
+            device.m_is_saved = true;
+        }
+    }
+
+    return all_configured;
+}
+
+bool Ds18b20Bus::scan_alarms(etl::ivector<Rom>& alarming_roms) const {
+    alarming_roms.clear();
+    if (alarming_roms.full()) {
+        return true;
+    }
+
+    SearchStatus status = DeviceCommands::search_devices(m_one_wire, true, m_retry_policies.get(RetryOperation::Alarm), [&](const Rom& rom) {
+        alarming_roms.push_back(rom);
+        return !alarming_roms.full();
+    });
+
+    return status != SearchStatus::NoPresence && status != SearchStatus::SearchFailed;
+}
+
+Resolution Ds18b20Bus::get_max_resolution(const etl::ivector<Ds18b20>& devices) {
+    Resolution resolution = Resolution::Low;
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (devices[i].get_resolution() > resolution) {
+            resolution = devices[i].get_resolution();
+        }
+    }
+
+    return resolution;
+}
+
+bool Ds18b20Bus::measure_temperatures(etl::ivector<Ds18b20>& devices, etl::ivector<std::optional<float>>& temperatures) {
+    temperatures.clear();
+
+    // Request a temperature measurement from all devices
+    if (!convert_all(get_max_resolution(devices))) {
+        return false;
+    }
+
+    // Read the result of each device
+    for (size_t i = 0; i < devices.size() && !temperatures.full(); i++) {
+        temperatures.push_back(devices[i].read_temperature());
+    }
+
+    return true;
+}
+
+bool Ds18b20Bus::measure_temperatures_raw(etl::ivector<Ds18b20>& devices, etl::ivector<std::optional<int16_t>>& temperatures) {
+    temperatures.clear();
+
+    // Request a temperature measurement from all devices
+    if (!convert_all(get_max_resolution(devices))) {
+        return false;
+    }
+
+    // Read the result of each device
+    for (size_t i = 0; i < devices.size() && !temperatures.full(); i++) {
+        temperatures.push_back(devices[i].read_temperature_raw());
+    }
+
+    return true;
+}
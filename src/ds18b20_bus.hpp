@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ds18b20.hpp"
+
+/**
+ * Contains functionality that acts upon all ds18b20 devices connected to the same OneWire object at once.
+ */
+class Ds18b20Bus {
+private:
+    OneWire& m_one_wire; ///< OneWire Object responsible for all OneWire communication.
+
+    const RetryPolicies& m_retry_policies; ///< How the bus-wide operations are retried when they fail.
+
+    std::optional<PowerSupplyMode> m_power_supply_mode; ///< The power supply mode of the bus, once it has been read.
+
+    /**
+     * @return The highest resolution among the devices (which determines the conversion time of the bus).
+     */
+    static Resolution get_max_resolution(const etl::ivector<Ds18b20>& devices);
+
+public:
+    /**
+     * Creates a Ds18b20Bus object configured to the specified OneWire.
+     * @param retry_policies How the bus-wide operations are retried when they fail (the Measure and PowerSupply
+     * policies are used). Must outlive the object.
+     */
+    Ds18b20Bus(OneWire& one_wire, const RetryPolicies& retry_policies = RetryPolicies::get_default());
+
+    /**
+     * Reads the power supply mode of all devices of the bus at once. The mode is only read once: later calls (and the
+     * conversions and EEPROM copies) reuse it, until set_power_supply_mode() changes it.
+     * @return If the read is successful, Parasite is returned if any device uses parasite power, External if not.
+     * If it failed, std::nullopt is returned.
+     */
+    std::optional<PowerSupplyMode> get_power_supply_mode();
+
+    /**
+     * Sets the power supply mode of the bus, e.g. one read by an earlier Ds18b20Bus object of the same bus.
+     * @param power_supply_mode The power supply mode, or std::nullopt to read it again (e.g. after devices were
+     * connected).
+     */
+    void set_power_supply_mode(std::optional<PowerSupplyMode> power_supply_mode);
+
+    /**
+     * Conducts a temperature measurement on all devices of the bus simultaneously. The conversion takes as long as
+     * the slowest device (the one with the highest resolution) needs. The bus is left idle for the conversion time
+     * of the given resolution before the completion is checked. If any device uses parasite power, the strong
+     * pull-up is held for that time instead.
+     * @param resolution The highest resolution among the devices of the bus.
+     * @return True if the conversion was successful, false if not.
+     */
+    bool convert_all(Resolution resolution = Resolution::VeryHigh);
+
+    /**
+     * Applies the same settings to all devices of the bus at once: a single scratchpad write (Skip ROM) if any device
+     * does not have the settings yet, a read back of each device to verify it, and a single copy to the EEPROM
+     * (Skip ROM) if any device does not have them saved yet. Nothing is written if all devices already have the settings.
+     * A device that fails the read back does not stop the others from being verified and saved.
+     * @param devices All devices of the bus (the write reaches every device connected on the GPIO pin).
+     * @param configuration The settings to apply.
+     * @param save Whether to also save the settings to the EEPROM.
+     * @return True if all devices have the settings, false if not.
+     */
+    bool configure_all(etl::ivector<Ds18b20>& devices, const Ds18b20Configuration& configuration, bool save);
+
+    /**
+     * Enumerates the devices whose alarm flag is raised (their last measured temperature was out of their limits)
+     * with a single Search Alarm traversal. The cost depends on the number of alarming devices, not on the number of
+     * devices of the bus.
+     * @param alarming_roms Filled with the Roms of the alarming devices. If there are more alarming devices than its
+     * capacity, the search stops when it is full.
+     * @return True if the search was successful, false if not.
+     */
+    bool scan_alarms(etl::ivector<Rom>& alarming_roms) const;
+
+    /**
+     * Conducts a temperature measurement on all devices of the bus simultaneously and then reads the temperature of
+     * each device. A full sweep costs a single conversion time instead of one per device.
+     * @param devices The devices to read. They must all be connected on the GPIO pin of this bus.
+     * @param temperatures Filled with one entry per device (in the same order). Each entry is the temperature of
+     * the device if the read was successful, or std::nullopt if it failed.
+     * @return True if the conversion was successful, false if not. If false, temperatures is left empty.
+     */
+    bool measure_temperatures(etl::ivector<Ds18b20>& devices, etl::ivector<std::optional<float>>& temperatures);
+
+    /**
+     * Same as measure_temperatures(), without floating point arithmetic.
+     * @param temperatures Filled with one entry per device, in 1/16 degree steps (see Temperature::from_raw).
+     */
+    bool measure_temperatures_raw(etl::ivector<Ds18b20>& devices, etl::ivector<std::optional<int16_t>>& temperatures);
+};
@@ -0,0 +1,37 @@
+#include "ds18b20_configuration.hpp"
+
+Ds18b20Configuration::Ds18b20Configuration(Resolution resolution, int8_t temperature_high_limit, int8_t temperature_low_limit)
+        : m_resolution(resolution), m_temperature_high_limit(temperature_high_limit), m_temperature_low_limit(temperature_low_limit) {
+
+}
+
+Ds18b20Configuration& Ds18b20Configuration::set_resolution(Resolution resolution) {
+    m_resolution = resolution;
+    return *this;
+}
+
+Ds18b20Configuration& Ds18b20Configuration::set_temperature_high_limit(int8_t temperature) {
+    m_temperature_high_limit = temperature;
+    return *this;
+}
+
+Ds18b20Configuration& Ds18b20Configuration::set_temperature_low_limit(int8_t temperature) {
+    m_temperature_low_limit = temperature;
+    return *this;
+}
+
+Resolution Ds18b20Configuration::get_resolution() const {
+    return m_resolution;
+}
+
+int8_t Ds18b20Configuration::get_temperature_high_limit() const {
+    return m_temperature_high_limit;
+}
+
+int8_t Ds18b20Configuration::get_temperature_low_limit() const {
+    return m_temperature_low_limit;
+}
+
+uint8_t Ds18b20Configuration::get_configuration_byte() const {
+    return Scratchpad().resolution_to_configuration(m_resolution);
+}
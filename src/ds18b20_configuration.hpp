@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "scratchpad.hpp"
+
+/**
+ * The configurable settings of a ds18b20 (resolution and alarm limits). Changes are collected here and applied to
+ * a device at once (see Ds18b20::configure and Ds18b20Bus::configure_all), so that they cost a single scratchpad
+ * write and at most one EEPROM write.
+ */
+class Ds18b20Configuration {
+private:
+    Resolution m_resolution; ///< The resolution of the temperature measurements
+    int8_t m_temperature_high_limit; ///< The upper temperature limit for triggering the alarm
+    int8_t m_temperature_low_limit; ///< The lower temperature limit for triggering the alarm
+
+public:
+    /**
+     * Creates a configuration with the given settings.
+     */
+    Ds18b20Configuration(Resolution resolution, int8_t temperature_high_limit, int8_t temperature_low_limit);
+
+    /**
+     * Sets the resolution of the temperature measurements.
+     * @return This object, to chain the changes.
+     */
+    Ds18b20Configuration& set_resolution(Resolution resolution);
+
+    /**
+     * Sets the upper temperature limit for triggering the alarm.
+     * @return This object, to chain the changes.
+     */
+    Ds18b20Configuration& set_temperature_high_limit(int8_t temperature);
+
+    /**
+     * Sets the lower temperature limit for triggering the alarm.
+     * @return This object, to chain the changes.
+     */
+    Ds18b20Configuration& set_temperature_low_limit(int8_t temperature);
+
+    /**
+     * @return The resolution of the temperature measurements.
+     */
+    Resolution get_resolution() const;
+
+    /**
+     * @return The upper temperature limit for triggering the alarm.
+     */
+    int8_t get_temperature_high_limit() const;
+
+    /**
+     * @return The lower temperature limit for triggering the alarm.
+     */
+    int8_t get_temperature_low_limit() const;
+
+    /**
+     * @return The configuration byte of the scratchpad for the resolution.
+     */
+    uint8_t get_configuration_byte() const;
+};
+
+/// The scratchpad and EEPROM writes of a device since its creation
+struct ConfigurationStatistics {
+    uint32_t scratchpad_writes = 0; ///< Scratchpad writes that were needed
+    uint32_t scratchpad_writes_avoided = 0; ///< Scratchpad writes skipped because the device already had the settings
+    uint32_t eeprom_writes = 0; ///< Copies of the scratchpad to the EEPROM that were needed
+    uint32_t eeprom_writes_avoided = 0; ///< Copies skipped because the EEPROM already had the settings
+};
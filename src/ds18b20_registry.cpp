@@ -0,0 +1,204 @@
+#include "ds18b20_registry.hpp"
+
+#include "ds18b20_bus.hpp"
+
+Ds18b20RegistryBase::Ds18b20RegistryBase(uint64_t* roms, int16_t* temperatures, int8_t* temperature_high_limits, int8_t* temperature_low_limits,
+        uint8_t* configurations, bool* has_temperature, bool* alarms, size_t capacity, const RetryPolicies& retry_policies)
+        : m_roms(roms), m_temperatures(temperatures), m_temperature_high_limits(temperature_high_limits),
+        m_temperature_low_limits(temperature_low_limits), m_configurations(configurations), m_has_temperature(has_temperature),
+        m_alarms(alarms), m_capacity(capacity), m_retry_policies(retry_policies) {
+
+}
+
+bool Ds18b20RegistryBase::read_scratchpad(OneWire& one_wire, size_t index) {
+    Rom rom = get_rom(index);
+    Retry retry(m_retry_policies.get(RetryOperation::Read));
+    while (retry.next()) {
+        CommandResult<Scratchpad> scratchpad = DeviceCommands::read_scratchpad(one_wire, rom);
+        if (!scratchpad.has_value()) {
+            continue;
+        }
+
+        store_scratchpad(index, scratchpad.value());
+        return true;
+    }
+
+    m_has_temperature[index] = false;
+    return false;
+}
+
+void Ds18b20RegistryBase::store_scratchpad(size_t index, const Scratchpad& scratchpad) {
+    m_temperatures[index] = scratchpad.get_raw_temperature();
+    m_temperature_high_limits[index] = scratchpad.get_temperature_high_limit();
+    m_temperature_low_limits[index] = scratchpad.get_temperature_low_limit();
+    m_configurations[index] = scratchpad.get_configuration();
+    m_has_temperature[index] = true;
+}
+
+size_t Ds18b20RegistryBase::find_devices(OneWire& one_wire) {
+    m_size = 0;
+    m_power_supply_mode = std::nullopt;
+    m_search_status = DeviceCommands::search_devices(one_wire, false, m_retry_policies.get(RetryOperation::Ping), [&](const Rom& rom) {
+        // Read the scratchpad
+        m_roms[m_size] = Rom::encode_rom(rom);
+        m_alarms[m_size] = false;
+        if (read_scratchpad(one_wire, m_size)) {
+            m_size++;
+        }
+
+        return !full();
+    });
+
+    return m_size;
+}
+
+SearchStatus Ds18b20RegistryBase::get_search_status() const {
+    return m_search_status;
+}
+
+bool Ds18b20RegistryBase::measure_temperatures(OneWire& one_wire) {
+    // Request a temperature measurement from all devices
+    if (!convert_all(one_wire)) {
+        return false;
+    }
+
+    read_temperatures(one_wire);
+
+    return true;
+}
+
+bool Ds18b20RegistryBase::convert_all(OneWire& one_wire) {
+    Ds18b20Bus bus(one_wire, m_retry_policies);
+    bus.set_power_supply_mode(m_power_supply_mode);
+    if (!bus.convert_all(get_max_resolution())) {
+        return false;
+    }
+    m_power_supply_mode = bus.get_power_supply_mode();
+
+    return true;
+}
+
+size_t Ds18b20RegistryBase::read_temperatures(OneWire& one_wire) {
+    size_t count = 0;
+    for (size_t i = 0; i < m_size; i++) {
+        if (read_scratchpad(one_wire, i)) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+std::optional<size_t> Ds18b20RegistryBase::scan_alarms(OneWire& one_wire) {
+    for (size_t i = 0; i < m_size; i++) {
+        m_alarms[i] = false;
+    }
+    if (m_size == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    SearchStatus status = DeviceCommands::search_devices(one_wire, true, m_retry_policies.get(RetryOperation::Alarm), [&](const Rom& rom) {
+        // Mark the device
+        int index = index_of(Rom::encode_rom(rom));
+        if (index >= 0) {
+            m_alarms[index] = true;
+            count++;
+        }
+
+        return count < m_size;
+    });
+    if (status == SearchStatus::NoPresence || status == SearchStatus::SearchFailed) {
+        return std::nullopt;
+    }
+
+    return count;
+}
+
+size_t Ds18b20RegistryBase::read_alarming_temperatures(OneWire& one_wire) {
+    size_t count = 0;
+    for (size_t i = 0; i < m_size; i++) {
+        if (m_alarms[i] && read_scratchpad(one_wire, i)) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+std::optional<size_t> Ds18b20RegistryBase::measure_alarms(OneWire& one_wire) {
+    // Request a temperature measurement from all devices, which also updates their alarm flags
+    if (!convert_all(one_wire)) {
+        return std::nullopt;
+    }
+
+    std::optional<size_t> count = scan_alarms(one_wire);
+    if (!count.has_value()) {
+        return std::nullopt;
+    }
+    read_alarming_temperatures(one_wire);
+
+    return count;
+}
+
+bool Ds18b20RegistryBase::is_alarm_active(size_t index) const {
+    return m_alarms[index];
+}
+
+size_t Ds18b20RegistryBase::size() const {
+    return m_size;
+}
+
+size_t Ds18b20RegistryBase::capacity() const {
+    return m_capacity;
+}
+
+bool Ds18b20RegistryBase::full() const {
+    return m_size >= m_capacity;
+}
+
+int Ds18b20RegistryBase::index_of(uint64_t rom) const {
+    for (size_t i = 0; i < m_size; i++) {
+        if (m_roms[i] == rom) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+Rom Ds18b20RegistryBase::get_rom(size_t index) const {
+    return Rom::decode_rom(m_roms[index]);
+}
+
+std::optional<int16_t> Ds18b20RegistryBase::get_raw_temperature(size_t index) const {
+    if (!m_has_temperature[index]) {
+        return std::nullopt;
+    }
+
+    return m_temperatures[index];
+}
+
+Resolution Ds18b20RegistryBase::get_max_resolution() const {
+    uint8_t config_setting = 0;
+    for (size_t i = 0; i < m_size; i++) {
+        uint8_t device_config_setting = (m_configurations[i] & 0b01100000) >> 5;
+        if (device_config_setting > config_setting) {
+            config_setting = device_config_setting;
+        }
+    }
+
+    return static_cast<Resolution>(config_setting);
+}
+
+int8_t Ds18b20RegistryBase::get_temperature_high_limit(size_t index) const {
+    return m_temperature_high_limits[index];
+}
+
+int8_t Ds18b20RegistryBase::get_temperature_low_limit(size_t index) const {
+    return m_temperature_low_limits[index];
+}
+
+uint8_t Ds18b20RegistryBase::get_configuration(size_t index) const {
+    return m_configurations[index];
+}
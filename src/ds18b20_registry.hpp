@@ -0,0 +1,194 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "device_commands.hpp"
+#include "retry_policy.hpp"
+
+/**
+ * A compact registry of the ds18b20 devices connected on the same OneWire object. The state of the devices is
+ * stored as a structure of arrays (packed Roms, cached temperatures and configurations) in storage provided by
+ * Ds18b20Registry<MaxDevices>, so no memory is allocated and bulk operations iterate over contiguous arrays.
+ * Uses 15 bytes per device.
+ */
+class Ds18b20RegistryBase {
+private:
+    uint64_t* m_roms; ///< The Roms of the devices (see Rom::encode_rom)
+    int16_t* m_temperatures; ///< The last temperature read from each device, in 1/16 degree steps
+    int8_t* m_temperature_high_limits; ///< The upper temperature limit for triggering the alarm of each device
+    int8_t* m_temperature_low_limits; ///< The lower temperature limit for triggering the alarm of each device
+    uint8_t* m_configurations; ///< The configuration byte of each device
+    bool* m_has_temperature; ///< Whether the last temperature read from each device was successful
+    bool* m_alarms; ///< Whether the alarm flag of each device was raised in the last scan_alarms() call
+    size_t m_capacity; ///< The maximum number of devices
+    size_t m_size = 0; ///< The number of devices
+    SearchStatus m_search_status = SearchStatus::Complete; ///< How the last find_devices() call ended
+    std::optional<PowerSupplyMode> m_power_supply_mode; ///< The power supply mode of the bus, read by the first conversion after find_devices()
+
+    const RetryPolicies& m_retry_policies; ///< How the operations on the devices are retried when they fail.
+
+    /**
+     * Reads the scratchpad of a device and stores it into the arrays.
+     * @return True if the read was successful, false if not.
+     */
+    bool read_scratchpad(OneWire& one_wire, size_t index);
+
+    /**
+     * Stores the scratchpad read from the index-th device into the arrays.
+     */
+    void store_scratchpad(size_t index, const Scratchpad& scratchpad);
+
+    /**
+     * Conducts a temperature measurement on all devices of the bus simultaneously (see Ds18b20Bus::convert_all),
+     * reading the power supply mode of the bus only the first time.
+     * @return True if the conversion was successful, false if not.
+     */
+    bool convert_all(OneWire& one_wire);
+
+    friend class BusManager;
+
+protected:
+    Ds18b20RegistryBase(uint64_t* roms, int16_t* temperatures, int8_t* temperature_high_limits, int8_t* temperature_low_limits,
+        uint8_t* configurations, bool* has_temperature, bool* alarms, size_t capacity, const RetryPolicies& retry_policies);
+
+public:
+    /**
+     * Scans the GPIO pin specified in the OneWire object and replaces the contents of the registry with the devices
+     * found (devices whose scratchpad cannot be read are skipped). The search steps are retried with the Ping retry
+     * policy. If more devices are connected than the capacity, the search stops when the registry is full.
+     * @param one_wire The OneWire object to act upon.
+     * @return The number of devices found. See get_search_status() for how the search ended.
+     */
+    size_t find_devices(OneWire& one_wire);
+
+    /**
+     * @return How the last find_devices() call ended (StorageFull if it stopped because the registry was full).
+     */
+    SearchStatus get_search_status() const;
+
+    /**
+     * Conducts a temperature measurement on all devices simultaneously and then reads the temperature of each device.
+     * @param one_wire The OneWire object the devices were found on.
+     * @return True if the conversion was successful, false if not.
+     */
+    bool measure_temperatures(OneWire& one_wire);
+
+    /**
+     * Reads the temperature of the last conversion of each device, without requesting a new one.
+     * @param one_wire The OneWire object the devices were found on.
+     * @return The number of devices that were read successfully.
+     */
+    size_t read_temperatures(OneWire& one_wire);
+
+    /**
+     * Finds the devices whose alarm flag is raised with a single Search Alarm traversal (see Ds18b20Bus::scan_alarms)
+     * and marks them (see is_alarm_active). Alarming devices that are not in the registry are ignored.
+     * @param one_wire The OneWire object the devices were found on.
+     * @return If the search was successful, the number of alarming devices is returned. If not, std::nullopt is returned.
+     */
+    std::optional<size_t> scan_alarms(OneWire& one_wire);
+
+    /**
+     * Reads the temperature of the devices marked by the last scan_alarms() call only.
+     * @param one_wire The OneWire object the devices were found on.
+     * @return The number of devices that were read successfully.
+     */
+    size_t read_alarming_temperatures(OneWire& one_wire);
+
+    /**
+     * Alarm-only monitoring: conducts a temperature measurement on all devices simultaneously, finds the alarming devices
+     * and reads the temperature of those only. The temperatures of the other devices are left unchanged, so the bus
+     * time of a sweep depends on the number of alarming devices instead of the number of devices.
+     * @param one_wire The OneWire object the devices were found on.
+     * @return If the conversion and the search were successful, the number of alarming devices is returned. If not,
+     * std::nullopt is returned.
+     */
+    std::optional<size_t> measure_alarms(OneWire& one_wire);
+
+    /**
+     * @return True if the alarm flag of the index-th device was raised in the last scan_alarms() call, false if not.
+     */
+    bool is_alarm_active(size_t index) const;
+
+    /**
+     * @return The number of devices.
+     */
+    size_t size() const;
+
+    /**
+     * @return The maximum number of devices.
+     */
+    size_t capacity() const;
+
+    /**
+     * @return True if no more devices can be added, false if not.
+     */
+    bool full() const;
+
+    /**
+     * @param rom The encoded Rom of a device (see Rom::encode_rom).
+     * @return The index of the device with the given Rom, or -1 if it is not in the registry.
+     */
+    int index_of(uint64_t rom) const;
+
+    /**
+     * @return The Rom of the index-th device.
+     */
+    Rom get_rom(size_t index) const;
+
+    /**
+     * @return If the last read of the index-th device was successful, its temperature in 1/16 degree steps
+     * (see Temperature::from_raw) is returned. If not, std::nullopt is returned.
+     */
+    std::optional<int16_t> get_raw_temperature(size_t index) const;
+
+    /**
+     * @return The highest resolution among the devices (which determines the conversion time of the bus).
+     */
+    Resolution get_max_resolution() const;
+
+    /**
+     * @return The upper temperature limit for triggering the alarm of the index-th device.
+     */
+    int8_t get_temperature_high_limit(size_t index) const;
+
+    /**
+     * @return The lower temperature limit for triggering the alarm of the index-th device.
+     */
+    int8_t get_temperature_low_limit(size_t index) const;
+
+    /**
+     * @return The configuration byte (containing the resolution) of the index-th device.
+     */
+    uint8_t get_configuration(size_t index) const;
+};
+
+/**
+ * A Ds18b20RegistryBase with storage for up to MaxDevices devices.
+ */
+template <size_t MaxDevices>
+class Ds18b20Registry : public Ds18b20RegistryBase {
+private:
+    uint64_t m_rom_storage[MaxDevices];
+    int16_t m_temperature_storage[MaxDevices];
+    int8_t m_temperature_high_limit_storage[MaxDevices];
+    int8_t m_temperature_low_limit_storage[MaxDevices];
+    uint8_t m_configuration_storage[MaxDevices];
+    bool m_has_temperature_storage[MaxDevices];
+    bool m_alarm_storage[MaxDevices];
+
+public:
+    /**
+     * Creates an empty registry.
+     * @param retry_policies How the operations on the devices are retried when they fail (the Read, Alarm, Measure
+     * and PowerSupply policies are used). Must outlive the object.
+     */
+    explicit Ds18b20Registry(const RetryPolicies& retry_policies = RetryPolicies::get_default())
+        : Ds18b20RegistryBase(m_rom_storage, m_temperature_storage, m_temperature_high_limit_storage,
+        m_temperature_low_limit_storage, m_configuration_storage, m_has_temperature_storage, m_alarm_storage, MaxDevices,
+        retry_policies) {}
+
+    // The base class points to the storage of this object
+    Ds18b20Registry(const Ds18b20Registry&) = delete;
+    Ds18b20Registry& operator=(const Ds18b20Registry&) = delete;
+};
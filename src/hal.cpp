@@ -0,0 +1,110 @@
+#include "hal.hpp"
+
+#include <cstring>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+// The flash sector used as persistent storage (the last one by default). The program must not extend into it.
+#ifndef DS18B20_STORAGE_OFFSET
+#define DS18B20_STORAGE_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#endif
+
+namespace {
+    uint64_t sleep_time_us = 0; ///< See Hal::get_sleep_time_us()
+}
+
+#ifdef SYS_CLK_KHZ
+static_assert(SYS_CLK_KHZ == DS18B20_CPU_MHZ * 1000, "DS18B20_CPU_MHZ must match the system clock");
+#endif
+
+void Hal::init_pin(int pin) {
+    gpio_init(pin);
+    gpio_pull_up(pin);
+}
+
+void Hal::set_pin_direction(int pin, bool output) {
+    gpio_set_dir(pin, output ? GPIO_OUT : GPIO_IN);
+}
+
+void Hal::set_pin_value(int pin, bool value) {
+    gpio_put(pin, value);
+}
+
+bool Hal::get_pin_value(int pin) {
+    return gpio_get(pin);
+}
+
+void Hal::sleep_us(uint32_t time_us) {
+    sleep_time_us += time_us;
+    ::sleep_us(time_us);
+}
+
+void Hal::busy_wait_cycles(uint32_t cycles) {
+    busy_wait_at_least_cycles(cycles);
+}
+
+uint32_t Hal::disable_interrupts() {
+    return save_and_disable_interrupts();
+}
+
+void Hal::restore_interrupts(uint32_t state) {
+    ::restore_interrupts(state);
+}
+
+void Hal::sleep_ms(uint32_t time_ms) {
+    sleep_time_us += time_ms * 1000ull;
+    ::sleep_ms(time_ms);
+}
+
+void Hal::launch_core1(void (*entry)()) {
+    multicore_launch_core1(entry);
+}
+
+size_t Hal::get_storage_size() {
+    return FLASH_SECTOR_SIZE;
+}
+
+bool Hal::read_storage(uint8_t* data, size_t length) {
+    if (length > FLASH_SECTOR_SIZE) {
+        return false;
+    }
+
+    // The flash is memory mapped
+    memcpy(data, (const uint8_t*)(XIP_BASE + DS18B20_STORAGE_OFFSET), length);
+    return true;
+}
+
+bool Hal::write_storage(const uint8_t* data, size_t length) {
+    if (length > FLASH_SECTOR_SIZE) {
+        return false;
+    }
+
+    // The flash is programmed one page at a time, the end of the last page is left erased
+    uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_erase(DS18B20_STORAGE_OFFSET, FLASH_SECTOR_SIZE);
+    for (size_t offset = 0; offset < length; offset += FLASH_PAGE_SIZE) {
+        size_t page_length = (length - offset < FLASH_PAGE_SIZE) ? length - offset : FLASH_PAGE_SIZE;
+        memset(page, 0xFF, FLASH_PAGE_SIZE);
+        memcpy(page, data + offset, page_length);
+        flash_range_program(DS18B20_STORAGE_OFFSET + offset, page, FLASH_PAGE_SIZE);
+    }
+    ::restore_interrupts(interrupts);
+
+    return true;
+}
+
+uint64_t Hal::get_sleep_time_us() {
+    return sleep_time_us;
+}
+
+uint64_t Hal::get_time_us() {
+    return to_us_since_boot(get_absolute_time());
+}
+
+uint32_t Hal::get_time_ms() {
+    return to_ms_since_boot(get_absolute_time());
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The frequency of the CPU in MHz, which the busy waits are computed from. Must match the system clock the program
+// runs at (checked against SYS_CLK_KHZ by hal.cpp).
+#ifndef DS18B20_CPU_MHZ
+#define DS18B20_CPU_MHZ 125
+#endif
+
+/**
+ * Contains all GPIO, timing and storage functionality the library needs from the platform. Everything above this layer
+ * (OneWire, DeviceCommands, Ds18b20) only talks to the hardware through it, so it can be run on another platform
+ * (for example, the simulated bus of the host tests, see test/host/hal.cpp) by providing another implementation of hal.cpp.
+ * The slot engine functions are implemented in hal_pio.cpp.
+ */
+class Hal {
+public:
+    static const uint32_t m_cycles_per_us = DS18B20_CPU_MHZ; ///< The number of CPU cycles per microsecond
+
+    /**
+     * Initializes the GPIO as an input and activates its pull-up resistor.
+     * @param pin The GPIO to initialize.
+     */
+    static void init_pin(int pin);
+
+    /**
+     * Sets the direction of the GPIO.
+     * @param pin The GPIO to configure.
+     * @param output True to drive the GPIO, false to release it (input).
+     */
+    static void set_pin_direction(int pin, bool output);
+
+    /**
+     * Sets the value the GPIO drives when it is an output.
+     * @param pin The GPIO to set.
+     * @param value The value to drive.
+     */
+    static void set_pin_value(int pin, bool value);
+
+    /**
+     * @param pin The GPIO to read.
+     * @return The value of the GPIO.
+     */
+    static bool get_pin_value(int pin);
+
+    /**
+     * Waits for the given amount of microseconds.
+     */
+    static void sleep_us(uint32_t time_us);
+
+    /**
+     * Waits for the given amount of microseconds by spinning for the equivalent number of CPU cycles. Unlike
+     * sleep_us(), it does not go through the timer alarms, so it is used for the short delays within time slots.
+     * It is inline, so the cycle count of a constant time (e.g. the delays of a predefined timing profile) is
+     * computed at compile time.
+     */
+    static inline void busy_wait_us(uint32_t time_us) {
+        busy_wait_cycles(time_us * m_cycles_per_us);
+    }
+
+    /**
+     * Waits for at least the given number of CPU cycles.
+     */
+    static void busy_wait_cycles(uint32_t cycles);
+
+    /**
+     * Disables the interrupts of the calling core.
+     * @return The previous interrupt state, to be passed to restore_interrupts().
+     */
+    static uint32_t disable_interrupts();
+
+    /**
+     * Restores the interrupt state of the calling core.
+     * @param state The state returned by disable_interrupts().
+     */
+    static void restore_interrupts(uint32_t state);
+
+    /**
+     * Waits for the given amount of milliseconds.
+     */
+    static void sleep_ms(uint32_t time_ms);
+
+    /**
+     * Claims a slot engine for a bus: a hardware unit that generates the resets and time slots of the 1-Wire protocol
+     * by itself, so the CPU only exchanges data with it. On the RP2040, it is a PIO state machine running
+     * one_wire.pio, with two DMA channels for block transfers (see hal_pio.cpp).
+     * @param pin The data pin of the bus. It is handed to the slot engine.
+     * @param cycles_per_us The number of cycles per microsecond of the slot engine, which scales all of its timings.
+     * @return The id of the slot engine, or -1 if none is available.
+     */
+    static int claim_slot_engine(int pin, uint8_t cycles_per_us);
+
+    /**
+     * Sets the number of cycles per microsecond of a slot engine (see claim_slot_engine).
+     */
+    static void set_slot_engine_speed(int engine, uint8_t cycles_per_us);
+
+    /**
+     * Issues a reset/presence sequence with a slot engine and waits for it to end.
+     * @return True if a presence pulse was detected, false if not.
+     */
+    static bool slot_engine_reset(int engine);
+
+    /**
+     * Issues one time slot per bit with a slot engine and waits for them to end.
+     * @param value The bits to write to the bus. LSB first.
+     * @param bits The number of bits (1 to 8).
+     * @return The values of the bus sampled in each slot. LSB first.
+     */
+    static uint8_t slot_engine_transfer(int engine, uint8_t value, uint8_t bits);
+
+    /**
+     * Starts issuing 8 time slots per byte with a slot engine, and returns without waiting for them. The buffers must
+     * stay valid until is_slot_engine_block_complete() returns true.
+     * @param write_data The bytes to write to the bus.
+     * @param increment_write If false, write_data[0] is written length times.
+     * @param read_data The buffer to store the bytes read from the bus.
+     * @param increment_read If false, every byte read is stored at read_data[0].
+     * @param length The number of bytes to transfer.
+     * @return True if the transfer was started, false if the slot engine has no block transfers (no DMA channels
+     * were available), in which case nothing is transferred.
+     */
+    static bool start_slot_engine_block(int engine, const uint8_t* write_data, bool increment_write, uint8_t* read_data,
+        bool increment_read, size_t length);
+
+    /**
+     * @return True if the last block transfer started with start_slot_engine_block() has ended, false if not.
+     */
+    static bool is_slot_engine_block_complete(int engine);
+
+    /**
+     * Hands the data pin to the slot engine or back to the GPIO functions above (e.g. to drive it high).
+     * @param attached True to give the pin to the slot engine, false to give it to the CPU.
+     */
+    static void attach_slot_engine_pin(int engine, bool attached);
+
+    /**
+     * Starts running the given function on the second core.
+     * @param entry The function to run.
+     */
+    static void launch_core1(void (*entry)());
+
+    /**
+     * @return The size of the persistent storage in bytes (a reserved sector of the flash, see hal.cpp).
+     */
+    static size_t get_storage_size();
+
+    /**
+     * Reads the beginning of the persistent storage.
+     * @param data The buffer to store the bytes read.
+     * @param length The number of bytes to read.
+     * @return True if the read was successful, false if length exceeds the storage size.
+     */
+    static bool read_storage(uint8_t* data, size_t length);
+
+    /**
+     * Replaces the content of the persistent storage. The flash is unavailable while it is written, so the other
+     * core must not be executing from flash (e.g. write before launching it).
+     * @param data The bytes to write at the beginning of the storage.
+     * @param length The number of bytes to write.
+     * @return True if the write was successful, false if length exceeds the storage size.
+     */
+    static bool write_storage(const uint8_t* data, size_t length);
+
+    /**
+     * @return The total time spent in sleep_us() and sleep_ms() since boot, in microseconds. During the rest of the
+     * time, the CPU was busy (e.g. in busy waits or polling).
+     */
+    static uint64_t get_sleep_time_us();
+
+    /**
+     * @return The time since boot in microseconds.
+     */
+    static uint64_t get_time_us();
+
+    /**
+     * @return The time since boot in milliseconds.
+     */
+    static uint32_t get_time_ms();
+};
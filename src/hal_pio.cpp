@@ -0,0 +1,202 @@
+#include "hal.hpp"
+
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+
+#include "one_wire.pio.h"
+
+namespace {
+
+/// A PIO state machine running the 1-Wire program, and the DMA channels servicing its FIFOs
+struct SlotEngine {
+    PIO pio; ///< The PIO block running the 1-Wire program
+    uint sm; ///< The state machine running the 1-Wire program
+    uint program_offset; ///< The offset of the 1-Wire program in the PIO instruction memory
+    uint fifo_threshold; ///< The current number of bits per FIFO entry
+    int pin; ///< The data pin of the bus
+    int tx_dma; ///< The DMA channel feeding the TX FIFO, -1 if none was available
+    int rx_dma; ///< The DMA channel draining the RX FIFO, -1 if none was available
+};
+
+const int max_slot_engines = 8; ///< The number of state machines of pio0 and pio1
+
+SlotEngine slot_engines[max_slot_engines]; ///< The claimed slot engines, indexed by their id
+
+int slot_engine_count = 0; ///< The number of claimed slot engines
+
+int program_offsets[2] = { -1, -1 }; ///< The offset of the 1-Wire program in pio0 and pio1, -1 if not loaded
+
+float get_clock_divider(uint8_t cycles_per_us) {
+    return clock_get_hz(clk_sys) / (1000000.0f * cycles_per_us);
+}
+
+/**
+ * Waits for the state machine to end its last reset or time slot (including its recovery time) and to stall on the
+ * empty TX FIFO, at the start of the next slot. Must only be called when no more data is queued in the TX FIFO.
+ */
+void wait_for_idle(SlotEngine& engine) {
+    uint32_t stall_flag = 1u << (PIO_FDEBUG_TXSTALL_LSB + engine.sm);
+    engine.pio->fdebug = stall_flag;
+    while ((engine.pio->fdebug & stall_flag) == 0) {
+        tight_loop_contents();
+    }
+}
+
+/**
+ * Sets the number of bits the state machine exchanges per FIFO entry. Must only be called when no more data is
+ * queued in the TX FIFO.
+ * @param bits The number of bits per FIFO entry (1 to 8).
+ */
+void set_fifo_threshold(SlotEngine& engine, uint bits) {
+    if (bits == engine.fifo_threshold) {
+        return;
+    }
+
+    // The OSR still holds the unused bits of the last entry, and autopull only refills it once the threshold number
+    // of bits was shifted out. Raising the threshold would make the next OUT issue slots for these stale bits, so
+    // the OSR is emptied first (the restart marks it as empty), once the state machine has ended its last slot.
+    wait_for_idle(engine);
+    pio_sm_restart(engine.pio, engine.sm);
+    pio_sm_exec(engine.pio, engine.sm, pio_encode_jmp(engine.program_offset + one_wire_offset_slot));
+    hw_write_masked(&engine.pio->sm[engine.sm].shiftctrl,
+        (bits << PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB) | (bits << PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB),
+        PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS | PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS);
+    engine.fifo_threshold = bits;
+}
+
+}
+
+int Hal::claim_slot_engine(int pin, uint8_t cycles_per_us) {
+    if (slot_engine_count >= max_slot_engines) {
+        return -1;
+    }
+
+    // Find a free state machine in a PIO block that has the program loaded, or has room for it. The state machines
+    // of a PIO block share its instruction memory, so the program is loaded once per block.
+    SlotEngine& engine = slot_engines[slot_engine_count];
+    PIO pios[2] = { pio0, pio1 };
+    int sm = -1;
+    int pio_index = 0;
+    for (; pio_index < 2; pio_index++) {
+        if (program_offsets[pio_index] < 0 && !pio_can_add_program(pios[pio_index], &one_wire_program)) {
+            continue;
+        }
+        sm = pio_claim_unused_sm(pios[pio_index], false);
+        if (sm >= 0) {
+            break;
+        }
+    }
+    if (sm < 0) {
+        return -1;
+    }
+    engine.pio = pios[pio_index];
+    if (program_offsets[pio_index] < 0) {
+        program_offsets[pio_index] = pio_add_program(engine.pio, &one_wire_program);
+    }
+    engine.sm = sm;
+    engine.pin = pin;
+    engine.program_offset = program_offsets[pio_index];
+
+    // 1 us per instruction at standard speed, LSB first, 8 bits per FIFO entry
+    pio_sm_config config = one_wire_program_get_default_config(engine.program_offset);
+    sm_config_set_in_pins(&config, pin);
+    sm_config_set_sideset_pins(&config, pin);
+    sm_config_set_out_shift(&config, true, true, 8);
+    sm_config_set_in_shift(&config, true, true, 8);
+    sm_config_set_clkdiv(&config, get_clock_divider(cycles_per_us));
+    engine.fifo_threshold = 8;
+
+    // The output value is always 0, the bus is driven by switching the pin direction
+    pio_gpio_init(engine.pio, pin);
+    gpio_pull_up(pin);
+    pio_sm_set_pins_with_mask(engine.pio, engine.sm, 0, 1u << pin);
+    pio_sm_set_pindirs_with_mask(engine.pio, engine.sm, 0, 1u << pin);
+
+    pio_sm_init(engine.pio, engine.sm, engine.program_offset + one_wire_offset_slot, &config);
+    pio_sm_set_enabled(engine.pio, engine.sm, true);
+
+    // Block transfers are not available if there are no DMA channels available
+    engine.tx_dma = dma_claim_unused_channel(false);
+    engine.rx_dma = dma_claim_unused_channel(false);
+    if (engine.tx_dma < 0 || engine.rx_dma < 0) {
+        if (engine.tx_dma >= 0) {
+            dma_channel_unclaim(engine.tx_dma);
+        }
+        if (engine.rx_dma >= 0) {
+            dma_channel_unclaim(engine.rx_dma);
+        }
+        engine.tx_dma = -1;
+        engine.rx_dma = -1;
+    }
+
+    return slot_engine_count++;
+}
+
+void Hal::set_slot_engine_speed(int engine, uint8_t cycles_per_us) {
+    // The last slot ends at the speed it started with
+    SlotEngine& e = slot_engines[engine];
+    wait_for_idle(e);
+    pio_sm_set_clkdiv(e.pio, e.sm, get_clock_divider(cycles_per_us));
+}
+
+bool Hal::slot_engine_reset(int engine) {
+    // Run the reset sequence once the last slot has ended, the state machine continues with the time slots afterwards
+    SlotEngine& e = slot_engines[engine];
+    wait_for_idle(e);
+    pio_sm_exec(e.pio, e.sm, pio_encode_jmp(e.program_offset + one_wire_offset_reset));
+    uint32_t pins = pio_sm_get_blocking(e.pio, e.sm);
+
+    return (pins & 0x01) == 0;
+}
+
+uint8_t Hal::slot_engine_transfer(int engine, uint8_t value, uint8_t bits) {
+    SlotEngine& e = slot_engines[engine];
+    set_fifo_threshold(e, bits);
+    pio_sm_put_blocking(e.pio, e.sm, value);
+
+    // The sampled bits are shifted in from the left
+    return pio_sm_get_blocking(e.pio, e.sm) >> (32 - bits);
+}
+
+bool Hal::start_slot_engine_block(int engine, const uint8_t* write_data, bool increment_write, uint8_t* read_data,
+        bool increment_read, size_t length) {
+    SlotEngine& e = slot_engines[engine];
+    if (e.tx_dma < 0) {
+        return false;
+    }
+    set_fifo_threshold(e, 8);
+
+    // Every written byte produces one RX FIFO entry, which has to be drained for the state machine to continue.
+    // The sampled byte is in the most significant byte of the entry.
+    dma_channel_config rx_config = dma_channel_get_default_config(e.rx_dma);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx_config, false);
+    channel_config_set_write_increment(&rx_config, increment_read);
+    channel_config_set_dreq(&rx_config, pio_get_dreq(e.pio, e.sm, false));
+    dma_channel_configure(e.rx_dma, &rx_config, read_data, ((io_rw_8*)&e.pio->rxf[e.sm]) + 3, length, true);
+
+    dma_channel_config tx_config = dma_channel_get_default_config(e.tx_dma);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&tx_config, increment_write);
+    channel_config_set_write_increment(&tx_config, false);
+    channel_config_set_dreq(&tx_config, pio_get_dreq(e.pio, e.sm, true));
+    dma_channel_configure(e.tx_dma, &tx_config, &e.pio->txf[e.sm], write_data, length, true);
+
+    return true;
+}
+
+bool Hal::is_slot_engine_block_complete(int engine) {
+    return !dma_channel_is_busy(slot_engines[engine].rx_dma);
+}
+
+void Hal::attach_slot_engine_pin(int engine, bool attached) {
+    // The state machine can only pull the bus low
+    SlotEngine& e = slot_engines[engine];
+    if (attached) {
+        pio_gpio_init(e.pio, e.pin);
+    } else {
+        gpio_set_function(e.pin, GPIO_FUNC_SIO);
+    }
+}
@@ -1,70 +1,394 @@
 #include "one_wire.hpp"
 
-#include "pico/stdlib.h"
+#include <cstring>
 
-OneWire::OneWire(int data_pin) : m_data_pin(data_pin) {
-    gpio_init(data_pin);
-    gpio_pull_up(data_pin);
+#include "crc8.hpp"
+#include "hal.hpp"
+
+OneWire::OneWire(int data_pin, OneWireBackend backend, int strong_pullup_pin)
+        : m_data_pin(data_pin), m_backend(backend), m_strong_pullup_pin(strong_pullup_pin) {
+    Hal::init_pin(data_pin);
+    if (m_strong_pullup_pin >= 0) {
+        Hal::init_pin(m_strong_pullup_pin);
+        Hal::set_pin_value(m_strong_pullup_pin, 0);
+        Hal::set_pin_direction(m_strong_pullup_pin, true);
+    }
+
+    if (m_backend == OneWireBackend::Pio) {
+        m_slot_engine = Hal::claim_slot_engine(data_pin, m_timing.pio_cycles_per_us);
+        if (m_slot_engine < 0) {
+            m_backend = OneWireBackend::BitBang;
+        }
+    }
+}
+
+OneWireBackend OneWire::get_backend() const {
+    return m_backend;
+}
+
+void OneWire::set_speed(OneWireSpeed speed) {
+    if (speed == OneWireSpeed::Overdrive) {
+        apply_timing(m_overdrive_timing, OneWireTimingProfile::Overdrive);
+    } else {
+        apply_timing(m_standard_timing, OneWireTimingProfile::Standard);
+    }
+}
+
+void OneWire::set_timing_profile(OneWireTimingProfile profile) {
+    switch (profile) {
+        case OneWireTimingProfile::Standard:
+            apply_timing(m_standard_timing, profile);
+            break;
+        case OneWireTimingProfile::Overdrive:
+            apply_timing(m_overdrive_timing, profile);
+            break;
+        case OneWireTimingProfile::LongLine:
+            apply_timing(m_long_line_timing, profile);
+            break;
+        case OneWireTimingProfile::ShortLine:
+            apply_timing(m_short_line_timing, profile);
+            break;
+        case OneWireTimingProfile::Custom:
+            break;
+    }
+}
+
+OneWireTimingProfile OneWire::get_timing_profile() const {
+    return m_timing_profile;
+}
+
+void OneWire::set_timing(const OneWireTiming& timing) {
+    apply_timing(timing, OneWireTimingProfile::Custom);
+}
+
+void OneWire::apply_timing(const OneWireTiming& timing, OneWireTimingProfile profile) {
+    m_timing = timing;
+    m_timing_profile = profile;
+    if (m_backend == OneWireBackend::Pio) {
+        Hal::set_slot_engine_speed(m_slot_engine, m_timing.pio_cycles_per_us);
+    }
+}
+
+const OneWireTiming& OneWire::get_timing() const {
+    return m_timing;
+}
+
+uint8_t OneWire::pio_transfer(uint8_t value, uint8_t bits) const {
+    uint64_t start_time = Hal::get_time_us();
+    uint8_t result = Hal::slot_engine_transfer(m_slot_engine, value, bits);
+    add_bus_time(start_time);
+
+    return result;
+}
+
+void OneWire::add_bus_time(uint64_t start_time_us) const {
+    m_statistics.bus_time_us += Hal::get_time_us() - start_time_us;
+}
+
+OneWireStatistics OneWire::get_statistics() const {
+    return m_statistics;
+}
+
+void OneWire::clear_statistics() {
+    m_statistics = OneWireStatistics();
 }
 
 bool OneWire::get_pin_value() const {
-    return gpio_get(m_data_pin);
+    return Hal::get_pin_value(m_data_pin);
 }
 
 void OneWire::set_pin_value(bool value) const {
-    gpio_put(m_data_pin, value);
+    Hal::set_pin_value(m_data_pin, value);
 }
 
-void OneWire::write_bit(bool value) const {
-    gpio_set_dir(m_data_pin, GPIO_OUT);
-    gpio_put(m_data_pin, 0);
+void OneWire::set_pin_direction(bool output) const {
+    Hal::set_pin_direction(m_data_pin, output);
+}
+
+void OneWire::set_interrupt_masking(OneWireInterruptMasking masking) {
+    m_interrupt_masking = masking;
+}
+
+OneWireInterruptMasking OneWire::get_interrupt_masking() const {
+    return m_interrupt_masking;
+}
+
+bool OneWire::enter_critical_section(OneWireInterruptMasking scope, uint32_t& state) const {
+    if (m_interrupt_masking != scope) {
+        return false;
+    }
+
+    state = Hal::disable_interrupts();
+    m_interrupts_disabled_time_us = Hal::get_time_us();
+    return true;
+}
+
+void OneWire::exit_critical_section(uint32_t state, uint32_t slots) const {
+    uint32_t time_us = Hal::get_time_us() - m_interrupts_disabled_time_us;
+    Hal::restore_interrupts(state);
+
+    m_statistics.masked_slots += slots;
+    if (time_us > m_statistics.max_interrupts_disabled_us) {
+        m_statistics.max_interrupts_disabled_us = time_us;
+    }
+}
+
+inline __attribute__((always_inline)) void OneWire::bit_bang_write_bit(const OneWireTiming& timing, bool value) const {
+    uint32_t interrupts;
+    bool masked = enter_critical_section(OneWireInterruptMasking::Slot, interrupts);
+    set_pin_direction(true);
+    set_pin_value(0);
     if (value) {
-        sleep_us(8);
-        gpio_set_dir(m_data_pin, GPIO_IN);
-        sleep_us(52);
+        Hal::busy_wait_us(timing.write_1_low_us);
+        set_pin_direction(false);
+        Hal::busy_wait_us(timing.write_1_high_us);
     } else {
-        sleep_us(60);
-        gpio_set_dir(m_data_pin, GPIO_IN);
+        Hal::busy_wait_us(timing.write_0_low_us);
+        set_pin_direction(false);
+    }
+    if (masked) {
+        exit_critical_section(interrupts, 1);
     }
-    sleep_us(5);
+    Hal::busy_wait_us(timing.write_recovery_us);
+}
+
+inline __attribute__((always_inline)) bool OneWire::bit_bang_read_bit(const OneWireTiming& timing) const {
+    // Only the part up to the sampling is timing critical
+    uint32_t interrupts;
+    bool masked = enter_critical_section(OneWireInterruptMasking::Slot, interrupts);
+    set_pin_direction(true);
+    set_pin_value(0);
+    Hal::busy_wait_us(timing.read_low_us);
+    set_pin_direction(false);
+    Hal::busy_wait_us(timing.read_sample_us);
+    bool data = get_pin_value();
+    if (masked) {
+        exit_critical_section(interrupts, 1);
+    }
+    Hal::busy_wait_us(timing.read_recovery_us);
+
+    return data;
+}
+
+void OneWire::write_bit(bool value) const {
+    m_statistics.write_slots++;
+    if (m_backend == OneWireBackend::Pio) {
+        pio_transfer(value, 1);
+        return;
+    }
+
+    // The predefined profiles are passed as constexpr objects, so each case gets its own copy of the slot with
+    // constant delays
+    uint64_t start_time = Hal::get_time_us();
+    switch (m_timing_profile) {
+        case OneWireTimingProfile::Standard:
+            bit_bang_write_bit(m_standard_timing, value);
+            break;
+        case OneWireTimingProfile::Overdrive:
+            bit_bang_write_bit(m_overdrive_timing, value);
+            break;
+        case OneWireTimingProfile::LongLine:
+            bit_bang_write_bit(m_long_line_timing, value);
+            break;
+        case OneWireTimingProfile::ShortLine:
+            bit_bang_write_bit(m_short_line_timing, value);
+            break;
+        case OneWireTimingProfile::Custom:
+            bit_bang_write_bit(m_timing, value);
+            break;
+    }
+    add_bus_time(start_time);
 }
 
 bool OneWire::read_bit() const {
-    gpio_set_dir(m_data_pin, GPIO_OUT);
-    gpio_put(m_data_pin, 0);
-    sleep_us(5);
-    gpio_set_dir(m_data_pin, GPIO_IN);
-    sleep_us(10);
-    bool data = gpio_get(m_data_pin);
-    sleep_us(50);
+    m_statistics.read_slots++;
+    if (m_backend == OneWireBackend::Pio) {
+        return pio_transfer(1, 1);
+    }
+
+    uint64_t start_time = Hal::get_time_us();
+    bool data = false;
+    switch (m_timing_profile) {
+        case OneWireTimingProfile::Standard:
+            data = bit_bang_read_bit(m_standard_timing);
+            break;
+        case OneWireTimingProfile::Overdrive:
+            data = bit_bang_read_bit(m_overdrive_timing);
+            break;
+        case OneWireTimingProfile::LongLine:
+            data = bit_bang_read_bit(m_long_line_timing);
+            break;
+        case OneWireTimingProfile::ShortLine:
+            data = bit_bang_read_bit(m_short_line_timing);
+            break;
+        case OneWireTimingProfile::Custom:
+            data = bit_bang_read_bit(m_timing);
+            break;
+    }
+    add_bus_time(start_time);
 
     return data;
 }
 
+OneWireTriplet OneWire::triplet(bool direction) const {
+    OneWireTriplet triplet;
+    if (m_backend == OneWireBackend::Pio) {
+        m_statistics.read_slots += 2;
+        uint8_t bits = pio_transfer(0b11, 2);
+        triplet.id_bit = bits & 0x01;
+        triplet.complement_bit = (bits >> 1) & 0x01;
+    } else {
+        triplet.id_bit = read_bit();
+        triplet.complement_bit = read_bit();
+    }
+
+    // If the devices agree, the bit they share is the only direction that keeps any of them selected
+    triplet.direction = (triplet.id_bit == triplet.complement_bit) ? (direction || triplet.id_bit) : triplet.id_bit;
+    write_bit(triplet.direction);
+
+    return triplet;
+}
+
 void OneWire::write_byte(uint8_t value) const {
+    if (m_backend == OneWireBackend::Pio) {
+        m_statistics.write_slots += 8;
+        pio_transfer(value, 8);
+        return;
+    }
+
+    uint32_t interrupts;
+    bool masked = enter_critical_section(OneWireInterruptMasking::Byte, interrupts);
     for (int i = 0; i < 8; i++) {
         bool bit = (value >> i) & 0x01;
         write_bit(bit);
     }
+    if (masked) {
+        exit_critical_section(interrupts, 8);
+    }
 }
 
 uint8_t OneWire::read_byte() const {
     uint8_t byte = 0;
-    for (int i = 0; i < 8; i++) {
-        byte |= (read_bit() << i);
+    if (m_backend == OneWireBackend::Pio) {
+        m_statistics.read_slots += 8;
+        byte = pio_transfer(0xFF, 8);
+    } else {
+        uint32_t interrupts;
+        bool masked = enter_critical_section(OneWireInterruptMasking::Byte, interrupts);
+        for (int i = 0; i < 8; i++) {
+            byte |= (read_bit() << i);
+        }
+        if (masked) {
+            exit_critical_section(interrupts, 8);
+        }
     }
+    m_crc = Crc8::update(m_crc, byte);
 
     return byte;
 }
 
+bool OneWire::pio_block_transfer(const uint8_t* write_data, bool increment_write, uint8_t* read_data, bool increment_read, size_t length) const {
+    uint64_t start_time = Hal::get_time_us();
+    if (!Hal::start_slot_engine_block(m_slot_engine, write_data, increment_write, read_data, increment_read, length)) {
+        return false;
+    }
+    while (!Hal::is_slot_engine_block_complete(m_slot_engine)) {
+    }
+    add_bus_time(start_time);
+
+    return true;
+}
+
+void OneWire::write_bytes(const uint8_t* data, size_t length) const {
+    uint8_t discarded;
+    if (m_backend == OneWireBackend::Pio && pio_block_transfer(data, true, &discarded, false, length)) {
+        m_statistics.write_slots += 8 * length;
+        return;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        write_byte(data[i]);
+    }
+}
+
+void OneWire::read_bytes(uint8_t* data, size_t length) const {
+    // Reading is done by issuing write 1 slots
+    const uint8_t all_ones = 0xFF;
+    if (m_backend == OneWireBackend::Pio && pio_block_transfer(&all_ones, false, data, true, length)) {
+        m_statistics.read_slots += 8 * length;
+        m_crc = Crc8::calculate(data, length, m_crc);
+        return;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        data[i] = read_byte();
+    }
+}
+
+bool OneWire::transaction(const uint8_t* write_data, size_t write_length, uint8_t* read_data, size_t read_length) const {
+    if (!start_transaction(write_data, write_length, read_data, read_length)) {
+        return false;
+    }
+    while (!is_transaction_complete()) {
+    }
+
+    return true;
+}
+
+bool OneWire::start_transaction(const uint8_t* write_data, size_t write_length, uint8_t* read_data, size_t read_length) const {
+    if (!reset()) {
+        return false;
+    }
+    reset_crc();
+
+    // Transfer the whole transaction as one block: the bytes to write, then 0xFF (read slots) for each byte to read.
+    // Each byte read replaces the byte sent in its slots, which the DMA has already consumed.
+    size_t length = write_length + read_length;
+    if (m_backend == OneWireBackend::Pio && length > 0 && length <= m_max_transaction_length) {
+        memcpy(m_transaction_data, write_data, write_length);
+        memset(&m_transaction_data[write_length], 0xFF, read_length);
+        if (Hal::start_slot_engine_block(m_slot_engine, m_transaction_data, true, m_transaction_data, true, length)) {
+            m_statistics.write_slots += 8 * write_length;
+            m_statistics.read_slots += 8 * read_length;
+            m_transaction_write_length = write_length;
+            m_transaction_read_data = read_data;
+            m_transaction_read_length = read_length;
+            m_transaction_start_time_us = Hal::get_time_us();
+            m_transaction_running = true;
+            return true;
+        }
+    }
+
+    write_bytes(write_data, write_length);
+    read_bytes(read_data, read_length);
+
+    return true;
+}
+
+bool OneWire::is_transaction_complete() const {
+    if (!m_transaction_running) {
+        return true;
+    }
+    if (!Hal::is_slot_engine_block_complete(m_slot_engine)) {
+        return false;
+    }
+    add_bus_time(m_transaction_start_time_us);
+    m_transaction_running = false;
+
+    memcpy(m_transaction_read_data, &m_transaction_data[m_transaction_write_length], m_transaction_read_length);
+    m_crc = Crc8::calculate(m_transaction_read_data, m_transaction_read_length, m_crc);
+
+    return true;
+}
+
 bool OneWire::wait_us_for_bit(bool bit, int max_time_us) const {
-    uint32_t start_time = to_us_since_boot(get_absolute_time());
-    while (to_us_since_boot(get_absolute_time()) - start_time < max_time_us) {
-        if (gpio_get(m_data_pin) == bit) {
+    uint64_t start_time = Hal::get_time_us();
+    while (Hal::get_time_us() - start_time < (uint64_t)max_time_us) {
+        if (get_pin_value() == bit) {
             return true;
         }
 
-        sleep_us(1);
+        Hal::busy_wait_us(1);
     }
 
     return false;
@@ -74,38 +398,60 @@ bool OneWire::wait_ms_for_bit(bool bit, int max_time_ms) const {
     return wait_us_for_bit(bit, max_time_ms * 1000);
 }
 
-uint8_t OneWire::calculate_crc_byte(uint8_t crc, uint8_t byte) {
-    crc ^= byte;
-    for (int i = 0; i < 8; i++) {
-        if (crc & 0x01) {
-            crc = (crc >> 1) ^ 0x8C;
-        } else {
-            crc >>= 1;
+void OneWire::set_strong_pullup(bool enabled) const {
+    if (m_strong_pullup_pin >= 0) {
+        Hal::set_pin_value(m_strong_pullup_pin, enabled);
+        return;
+    }
+
+    // The slot engine can only pull the bus low, so the pin is handed back to the CPU while driven high
+    if (enabled) {
+        if (m_backend == OneWireBackend::Pio) {
+            Hal::attach_slot_engine_pin(m_slot_engine, false);
+        }
+        set_pin_value(1);
+        set_pin_direction(true);
+    } else {
+        set_pin_direction(false);
+        set_pin_value(0);
+        if (m_backend == OneWireBackend::Pio) {
+            Hal::attach_slot_engine_pin(m_slot_engine, true);
         }
     }
+}
 
-    return crc;
+void OneWire::reset_crc() const {
+    m_crc = 0;
 }
 
-bool OneWire::reset() {
-    // Write 0 to initialize connection
-    gpio_set_dir(m_data_pin, GPIO_OUT);
-    set_pin_value(0);
-    sleep_us(500);
+uint8_t OneWire::get_crc() const {
+    return m_crc;
+}
 
-    // Wait for presence pulse
-    gpio_set_dir(m_data_pin, GPIO_IN);
-    sleep_us(5);
-    bool detected_presence_pulse = wait_us_for_bit(0, 240 + 55);
-    if (!detected_presence_pulse) {
-        return false;
-    }
+uint8_t OneWire::calculate_crc_byte(uint8_t crc, uint8_t byte) {
+    return Crc8::update(crc, byte);
+}
 
-    // Wait for presence pulse to end
-    bool detected_presence_pulse_end = wait_us_for_bit(1, 240);
-    if (!detected_presence_pulse_end) {
-        return false;
+bool OneWire::reset() const {
+    m_statistics.resets++;
+    uint64_t start_time = Hal::get_time_us();
+
+    bool detected_presence_pulse;
+    if (m_backend == OneWireBackend::Pio) {
+        detected_presence_pulse = Hal::slot_engine_reset(m_slot_engine);
+    } else {
+        // Write 0 to initialize connection
+        set_pin_direction(true);
+        set_pin_value(0);
+        Hal::sleep_us(m_timing.reset_low_us);
+
+        // Wait for presence pulse and for it to end
+        set_pin_direction(false);
+        Hal::busy_wait_us(m_timing.presence_delay_us);
+        detected_presence_pulse = wait_us_for_bit(0, m_timing.presence_timeout_us) &&
+            wait_us_for_bit(1, m_timing.presence_end_timeout_us);
     }
+    add_bus_time(start_time);
 
-    return true;
+    return detected_presence_pulse;
 }
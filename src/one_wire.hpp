@@ -1,14 +1,189 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
+
+/// The way the time slots of the 1-Wire protocol are generated
+enum class OneWireBackend {
+    BitBang, ///< The CPU drives the data pin and times the slots with busy waits.
+    Pio ///< A PIO state machine generates the slots, the CPU only exchanges data through its FIFOs.
+};
+
+/// The speed of the 1-Wire protocol
+enum class OneWireSpeed {
+    Standard, ///< Standard speed (about 16 kbps), supported by every device
+    Overdrive ///< Overdrive speed (about 8 times faster), only supported by some devices (not by the ds18b20)
+};
+
+/// The scope in which the bit-banged time slots run with the interrupts of the core disabled
+enum class OneWireInterruptMasking {
+    None, ///< Interrupts stay enabled, so an interrupt can stretch a slot and corrupt the bit
+    Slot, ///< Interrupts are disabled for the timing critical part of each slot and enabled again for its recovery time
+    Byte ///< Interrupts are disabled for the 8 slots of each byte (at most about 0.6 ms at standard speed)
+};
+
+/// The predefined timings of the resets and time slots (see OneWire::set_timing_profile)
+enum class OneWireTimingProfile {
+    Standard, ///< Standard speed, with the values recommended by the ds18b20 datasheet
+    Overdrive, ///< Overdrive speed
+    LongLine, ///< Standard speed for long or heavily loaded lines: shorter low times and longer recovery times, so the bus has more time to rise
+    ShortLine, ///< Standard speed for short lines with few devices: minimal recovery times, for a higher throughput
+    Custom ///< The timing given to OneWire::set_timing
+};
+
+/**
+ * The timing of the reset/presence sequence and of the time slots of the 1-Wire protocol, in microseconds. The Pio
+ * backend runs a fixed program and only uses pio_cycles_per_us, which scales all of its timings at once (1 for
+ * standard speed, 8 for overdrive speed).
+ */
+struct OneWireTiming {
+    uint16_t reset_low_us; ///< The time the bus is pulled low to reset the devices
+    uint16_t presence_delay_us; ///< The time between the release of the bus and the start of the presence detection
+    uint16_t presence_timeout_us; ///< The maximum time to wait for the presence pulse
+    uint16_t presence_end_timeout_us; ///< The maximum time to wait for the end of the presence pulse
+    uint16_t write_1_low_us; ///< The time the bus is pulled low in a write 1 slot
+    uint16_t write_1_high_us; ///< The time the bus is released in a write 1 slot
+    uint16_t write_0_low_us; ///< The time the bus is pulled low in a write 0 slot
+    uint16_t write_recovery_us; ///< The time the bus is released between two write slots
+    uint16_t read_low_us; ///< The time the bus is pulled low at the start of a read slot
+    uint16_t read_sample_us; ///< The time between the release of the bus and the sampling in a read slot
+    uint16_t read_recovery_us; ///< The time between the sampling and the end of a read slot
+    uint8_t pio_cycles_per_us; ///< The number of cycles per microsecond of the PIO state machine
+};
+
+/// The result of a search triplet (see OneWire::triplet)
+struct OneWireTriplet {
+    bool id_bit; ///< The first bit read: the AND of the current Rom bit of all participating devices
+    bool complement_bit; ///< The second bit read: the AND of the complement of the current Rom bit of all participating devices
+    bool direction; ///< The bit written, which deselects the devices whose Rom bit differs from it
+};
+
+/// Counters of the traffic of a OneWire object, used for measuring the cost of higher level operations
+struct OneWireStatistics {
+    uint32_t resets = 0; ///< The number of reset/presence sequences issued
+    uint32_t write_slots = 0; ///< The number of write time slots issued
+    uint32_t read_slots = 0; ///< The number of read time slots issued
+    uint64_t bus_time_us = 0; ///< The total time spent generating resets and time slots, in microseconds
+    uint32_t masked_slots = 0; ///< The number of time slots issued with the interrupts disabled
+    uint32_t max_interrupts_disabled_us = 0; ///< The longest time the interrupts were disabled for, in microseconds
+};
 
 /**
  * Contains functionality for the 1-Wire protocol used for ds18b20 communication.
  */
 class OneWire {
+public:
+    /// The timing of standard speed
+    static constexpr OneWireTiming m_standard_timing = { 500, 5, 295, 240, 8, 52, 60, 5, 5, 10, 50, 1 };
+
+    /// The timing of overdrive speed
+    static constexpr OneWireTiming m_overdrive_timing = { 70, 2, 28, 24, 1, 7, 8, 2, 1, 1, 7, 8 };
+
+    /// The timing of the LongLine profile
+    static constexpr OneWireTiming m_long_line_timing = { 600, 15, 285, 240, 5, 60, 60, 10, 3, 11, 56, 1 };
+
+    /// The timing of the ShortLine profile
+    static constexpr OneWireTiming m_short_line_timing = { 490, 5, 295, 240, 6, 54, 60, 2, 2, 11, 47, 1 };
+
+    /// The maximum number of bytes (written and read) of a transaction transferred while the CPU is free (see start_transaction)
+    static const size_t m_max_transaction_length = 24;
+
 private:
     int m_data_pin; ///< The GPIO used for data communication
 
+    OneWireTiming m_timing = m_standard_timing; ///< The timing of the resets and time slots
+
+    OneWireTimingProfile m_timing_profile = OneWireTimingProfile::Standard; ///< The profile m_timing comes from
+
+    OneWireBackend m_backend; ///< The backend generating the time slots
+
+    OneWireInterruptMasking m_interrupt_masking = OneWireInterruptMasking::None; ///< The scope in which the bit-banged slots run with interrupts disabled
+
+    mutable uint64_t m_interrupts_disabled_time_us = 0; ///< The time at which the interrupts were disabled (us since boot)
+
+    int m_strong_pullup_pin; ///< The GPIO enabling an external strong pull-up, -1 to drive the data pin high instead
+
+    int m_slot_engine = -1; ///< The slot engine generating the time slots (Pio backend only, see Hal::claim_slot_engine)
+
+    mutable uint8_t m_crc = 0; ///< The CRC value of all bytes read since the last reset_crc() call
+
+    mutable OneWireStatistics m_statistics; ///< The traffic since the creation or the last clear_statistics() call
+
+    mutable bool m_transaction_running = false; ///< Whether a transaction started with start_transaction() is being transferred
+
+    /// The bytes of the running transaction: the bytes written, then 0xFF for each byte read, replaced by the bytes read
+    mutable uint8_t m_transaction_data[m_max_transaction_length];
+
+    mutable size_t m_transaction_write_length = 0; ///< The number of bytes written by the running transaction
+
+    mutable uint8_t* m_transaction_read_data = nullptr; ///< The buffer of the bytes read by the running transaction
+
+    mutable size_t m_transaction_read_length = 0; ///< The number of bytes read by the running transaction
+
+    mutable uint64_t m_transaction_start_time_us = 0; ///< The time at which the transfer of the running transaction started (us since boot)
+
+    /**
+     * Switches to the given timing, and the slot engine to its speed.
+     * @param timing The new timing.
+     * @param profile The profile the timing comes from.
+     */
+    void apply_timing(const OneWireTiming& timing, OneWireTimingProfile profile);
+
+    /**
+     * Adds the time passed since start_time_us to the bus time statistics.
+     * @param start_time_us The time (us since boot) at which the bus operation started.
+     */
+    void add_bus_time(uint64_t start_time_us) const;
+
+    /**
+     * Issues one time slot per bit through the slot engine.
+     * @param value The bits to write to the bus. LSB first.
+     * @param bits The number of bits (1 to 8).
+     * @return The values of the bus sampled in each slot. LSB first.
+     */
+    uint8_t pio_transfer(uint8_t value, uint8_t bits) const;
+
+    /**
+     * Issues 8 time slots per byte through the slot engine, as a single block transfer.
+     * @param write_data The bytes to write to the bus.
+     * @param increment_write If false, write_data[0] is written length times.
+     * @param read_data The buffer to store the bytes read from the bus.
+     * @param increment_read If false, every byte read is stored at read_data[0].
+     * @param length The number of bytes to transfer.
+     * @return True if the bytes were transferred, false if the slot engine has no block transfers.
+     */
+    bool pio_block_transfer(const uint8_t* write_data, bool increment_write, uint8_t* read_data, bool increment_read, size_t length) const;
+
+    /**
+     * Disables the interrupts if the interrupt masking is set to scope.
+     * @param scope The scope of the calling code.
+     * @param state Set to the previous interrupt state if the interrupts were disabled.
+     * @return True if the interrupts were disabled, in which case exit_critical_section() must be called.
+     */
+    bool enter_critical_section(OneWireInterruptMasking scope, uint32_t& state) const;
+
+    /**
+     * Restores the interrupts disabled by enter_critical_section() and updates the statistics.
+     * @param state The previous interrupt state set by enter_critical_section().
+     * @param slots The number of time slots issued with the interrupts disabled.
+     */
+    void exit_critical_section(uint32_t state, uint32_t slots) const;
+
+    /**
+     * Issues a write slot with the CPU. Inlined into write_bit() once per profile, so the delays of the predefined
+     * profiles are compile-time constants.
+     * @param timing The timing of the slot.
+     * @param value The value to write to the bus.
+     */
+    void bit_bang_write_bit(const OneWireTiming& timing, bool value) const;
+
+    /**
+     * Issues a read slot with the CPU. Inlined into read_bit() once per profile, like bit_bang_write_bit().
+     * @param timing The timing of the slot.
+     * @return The value of the bus in this read slot.
+     */
+    bool bit_bang_read_bit(const OneWireTiming& timing) const;
+
     /**
      * Reads whether the data pin is set to low or high.
      * @return The value of the data pin.
@@ -21,6 +196,12 @@ private:
      */
     void set_pin_value(bool value) const;
 
+    /**
+     * Sets the direction of the data pin.
+     * @param output True to drive the data pin, false to release it (input).
+     */
+    void set_pin_direction(bool output) const;
+
     /**
      * Waits until the value of the data pin is equal to the bit parameter or until max_time_us microseconds
      * have passed.
@@ -44,8 +225,63 @@ public:
      * Creates a OneWire object operating on data_pin. Also, initializes this GPIO
      * and activates its pull-up resistor.
      * @param data_pin The GPIO used for data communication.
+     * @param backend The backend generating the time slots. If Pio is requested but no PIO state machine
+     * is available (see Hal::claim_slot_engine), BitBang is used instead.
+     * @param strong_pullup_pin The GPIO driving an external strong pull-up (e.g. the gate driver of a MOSFET
+     * between the bus and VDD), which is driven high while the strong pull-up is enabled. -1 to drive the data
+     * pin itself high (push-pull) instead.
+     */
+    OneWire(int data_pin, OneWireBackend backend = OneWireBackend::BitBang, int strong_pullup_pin = -1);
+
+    /**
+     * @return The backend generating the time slots.
+     */
+    OneWireBackend get_backend() const;
+
+    /**
+     * Sets the speed of the resets and time slots. Switching the devices to overdrive speed is done with the Overdrive
+     * Skip ROM or Overdrive Match ROM commands (see DeviceCommands), which switch the OneWire object as well.
+     * A reset at standard speed switches all devices back to standard speed.
+     * @param speed The new speed.
+     */
+    void set_speed(OneWireSpeed speed);
+
+    /**
+     * Selects one of the predefined timings of the resets and time slots. Each OneWire object (bus) has its own profile.
+     * @param profile The new profile. Custom keeps the current timing.
+     */
+    void set_timing_profile(OneWireTimingProfile profile);
+
+    /**
+     * @return The profile of the current timing.
      */
-    OneWire(int data_pin);
+    OneWireTimingProfile get_timing_profile() const;
+
+    /**
+     * Sets a custom timing of the resets and time slots. Prefer a predefined profile (set_timing_profile) when one
+     * fits: their delays are compile-time constants, while a custom timing is read from memory in every slot.
+     * @param timing The new timing (see m_standard_timing for the standard values).
+     */
+    void set_timing(const OneWireTiming& timing);
+
+    /**
+     * @return The timing of the resets and time slots.
+     */
+    const OneWireTiming& get_timing() const;
+
+    /**
+     * Sets whether the bit-banged time slots run with the interrupts of the core disabled. An interrupt within the
+     * low time or before the sampling of a slot stretches it, which the devices read as a wrong bit (and which shows
+     * up as CRC errors). The reset sequence is never masked since it tolerates longer timings. The Pio backend is not
+     * affected by interrupts, so this has no effect on it.
+     * @param masking The scope in which interrupts are disabled.
+     */
+    void set_interrupt_masking(OneWireInterruptMasking masking);
+
+    /**
+     * @return The scope in which the bit-banged time slots run with the interrupts disabled.
+     */
+    OneWireInterruptMasking get_interrupt_masking() const;
 
     /**
      * Issues a write slot and writes the given bit to the bus.
@@ -59,6 +295,16 @@ public:
      */
     bool read_bit() const;
 
+    /**
+     * Issues the 3 time slots of one Rom bit of a search (Search ROM or Search Alarm): reads the bit and its complement,
+     * then writes the direction. With the Pio backend, both read slots are issued with a single FIFO exchange.
+     * @param direction The direction to take if the participating devices differ at this bit (both bits read are 0).
+     * If they don't, the bit they all share is written instead.
+     * @return The bits read and the direction written. If both bits read are 1, no device participates and 1 is
+     * written (which has no effect).
+     */
+    OneWireTriplet triplet(bool direction) const;
+
     /**
      * Issues 8 write slots and writes the given byte to the bus.
      * @param value 8-bits of data to be sent. LSB first (LSB is the rightmost bit).
@@ -71,6 +317,76 @@ public:
      */
     uint8_t read_byte() const;
 
+    /**
+     * Writes the given bytes to the bus. With the Pio backend, the whole block is transferred at once (by DMA).
+     * @param data The bytes to write. Each byte is sent LSB first.
+     * @param length The number of bytes to write.
+     */
+    void write_bytes(const uint8_t* data, size_t length) const;
+
+    /**
+     * Reads the given number of bytes from the bus. With the Pio backend, the whole block is transferred at once (by DMA).
+     * @param data The buffer to store the bytes that were read. Each byte is received LSB first.
+     * @param length The number of bytes to read.
+     */
+    void read_bytes(uint8_t* data, size_t length) const;
+
+    /**
+     * Conducts a complete transaction: resets the bus, writes write_length bytes and then reads read_length bytes.
+     * The CRC calculation is restarted before the bytes are read (see get_crc).
+     * @param write_data The bytes to write after the reset (ROM command, function command and payload).
+     * @param write_length The number of bytes to write.
+     * @param read_data The buffer to store the bytes that were read.
+     * @param read_length The number of bytes to read.
+     * @return True if any device responded to the reset, false if not (no bytes are transferred).
+     */
+    bool transaction(const uint8_t* write_data, size_t write_length, uint8_t* read_data, size_t read_length) const;
+
+    /**
+     * Same as transaction, but returns after the reset. With the Pio backend, the bytes are then transferred as a
+     * single block by DMA while the CPU is free, and is_transaction_complete() must be called until it returns true
+     * (which copies the bytes read to read_data). With the BitBang backend, if the slot engine has no block transfers
+     * or if the transaction has more than m_max_transaction_length bytes, the whole transaction is done before
+     * returning. No other operation may be issued on the bus until the transaction is complete, and read_data must
+     * stay valid until then.
+     * @return True if any device responded to the reset, false if not (no bytes are transferred).
+     */
+    bool start_transaction(const uint8_t* write_data, size_t write_length, uint8_t* read_data, size_t read_length) const;
+
+    /**
+     * @return True if the transaction started with start_transaction() has ended (or none was started), false if not.
+     */
+    bool is_transaction_complete() const;
+
+    /**
+     * Enables or disables the strong pull-up of the bus. Devices in parasite power mode need it during temperature
+     * conversions and EEPROM writes, and it must be enabled within 10 us after the command. No time slots can be
+     * issued while it is enabled.
+     * @param enabled True to pull the bus strongly high, false to release it.
+     */
+    void set_strong_pullup(bool enabled) const;
+
+    /**
+     * Restarts the CRC calculation of the bytes read from the bus.
+     */
+    void reset_crc() const;
+
+    /**
+     * @return The CRC value of all bytes read (with read_byte/read_bytes) since the last reset_crc() call.
+     * It is 0 if the bytes read ended with their valid CRC code.
+     */
+    uint8_t get_crc() const;
+
+    /**
+     * @return The traffic since the creation of this object or the last clear_statistics() call.
+     */
+    OneWireStatistics get_statistics() const;
+
+    /**
+     * Sets all traffic counters to 0.
+     */
+    void clear_statistics();
+
     /**
      * Calcualtes the new CRC value, taking the byte parameter into the CRC calculation.
      * @param crc The current crc value: 0 if this is the first calculation, the previous crc value if not.
@@ -83,5 +399,5 @@ public:
      * Writes 0 to the bus and waits for any device to send the presence pulse. After, it waits for the response to stop.
      * @return True if any ds18b20 using the specified data pin responded, false if not.
      */
-    bool reset();
+    bool reset() const;
 };
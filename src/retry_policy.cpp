@@ -0,0 +1,72 @@
+#include "retry_policy.hpp"
+
+#include "hal.hpp"
+
+const RetryPolicy& RetryPolicies::get(RetryOperation operation) const {
+    return m_policies[static_cast<size_t>(operation)];
+}
+
+void RetryPolicies::set(RetryOperation operation, const RetryPolicy& policy) {
+    m_policies[static_cast<size_t>(operation)] = policy;
+}
+
+void RetryPolicies::set_all(const RetryPolicy& policy) {
+    for (size_t i = 0; i < m_operation_count; i++) {
+        m_policies[i] = policy;
+    }
+}
+
+const RetryPolicies& RetryPolicies::get_default() {
+    static const RetryPolicies policies;
+    return policies;
+}
+
+Retry::Retry(const RetryPolicy& policy) : m_policy(policy) {
+    m_start_time_us = Hal::get_time_us();
+    m_backoff_us = policy.initial_backoff_us;
+}
+
+bool Retry::next() {
+    if (m_attempts >= m_policy.max_attempts) {
+        return false;
+    }
+
+    // Leave the bus idle before retrying, unless the deadline would pass in the meantime
+    if (m_attempts > 0 && m_backoff_us > 0) {
+        if (m_backoff_us >= get_remaining_us()) {
+            return false;
+        }
+        Hal::sleep_us(m_backoff_us);
+
+        // Without max_backoff_us, the backoff keeps doubling (within the range of its type)
+        if (m_backoff_us <= UINT32_MAX / 2) {
+            m_backoff_us *= 2;
+        }
+        if (m_policy.max_backoff_us > 0 && m_backoff_us > m_policy.max_backoff_us) {
+            m_backoff_us = m_policy.max_backoff_us;
+        }
+    }
+    if (get_remaining_us() == 0) {
+        return false;
+    }
+
+    m_attempts++;
+    return true;
+}
+
+int Retry::get_attempts() const {
+    return m_attempts;
+}
+
+uint32_t Retry::get_remaining_us() const {
+    if (m_policy.deadline_us == 0) {
+        return UINT32_MAX;
+    }
+
+    uint64_t elapsed_time = Hal::get_time_us() - m_start_time_us;
+    if (elapsed_time >= m_policy.deadline_us) {
+        return 0;
+    }
+
+    return m_policy.deadline_us - elapsed_time;
+}
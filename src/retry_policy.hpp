@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// The kinds of operations that have their own retry policy
+enum class RetryOperation {
+    Measure, ///< Requesting a temperature conversion
+    Read, ///< Reading the scratchpad
+    Configure, ///< Writing the scratchpad and copying it to the EEPROM
+    Ping, ///< Checking that a device responds
+    Alarm, ///< Checking the alarm flag
+    PowerSupply ///< Reading the power supply mode
+};
+
+/**
+ * How an operation is retried when an attempt fails. Attempts are repeated until max_attempts is reached or the
+ * deadline has passed, whichever comes first. Between two attempts, the bus is left idle for a backoff time that
+ * starts at initial_backoff_us and doubles after every attempt, up to max_backoff_us.
+ */
+struct RetryPolicy {
+    int max_attempts = 10; ///< The maximum number of attempts
+    uint32_t initial_backoff_us = 0; ///< The time between the first and the second attempt. 0 to retry immediately
+    uint32_t max_backoff_us = 0; ///< The maximum time between two attempts. 0 for no maximum
+    uint32_t deadline_us = 0; ///< The maximum total time of the operation, including the backoff. 0 for no deadline
+};
+
+/**
+ * A retry policy per operation. A RetryPolicies object can be shared by all devices of a bus (see
+ * Ds18b20::set_retry_policies), so that the retries of a bus can be configured in a single place.
+ */
+class RetryPolicies {
+private:
+    static const size_t m_operation_count = 6; ///< The number of values of RetryOperation
+
+    RetryPolicy m_policies[m_operation_count]; ///< The policy of each operation
+
+public:
+    /**
+     * @return The policy of the given operation.
+     */
+    const RetryPolicy& get(RetryOperation operation) const;
+
+    /**
+     * Sets the policy of the given operation.
+     */
+    void set(RetryOperation operation, const RetryPolicy& policy);
+
+    /**
+     * Sets the policy of every operation.
+     */
+    void set_all(const RetryPolicy& policy);
+
+    /**
+     * @return The policies used when none are set: 10 attempts without backoff or deadline.
+     */
+    static const RetryPolicies& get_default();
+};
+
+/**
+ * Keeps track of the attempts of an operation according to a retry policy. Used as
+ * `Retry retry(policy); while (retry.next()) { ... }`, where each iteration is an attempt.
+ */
+class Retry {
+private:
+    RetryPolicy m_policy; ///< The policy of the operation
+
+    uint64_t m_start_time_us; ///< The time (us since boot) at which the operation started
+
+    int m_attempts = 0; ///< The number of attempts started so far
+
+    uint32_t m_backoff_us; ///< The time to wait before the next attempt
+
+public:
+    /**
+     * Starts an operation.
+     */
+    explicit Retry(const RetryPolicy& policy);
+
+    /**
+     * Waits for the backoff time (except before the first attempt) and starts the next attempt.
+     * @return True if another attempt is allowed, false if the attempts are exhausted or the deadline would pass.
+     */
+    bool next();
+
+    /**
+     * @return The number of attempts started so far.
+     */
+    int get_attempts() const;
+
+    /**
+     * @return The time left until the deadline, in microseconds. UINT32_MAX if the policy has no deadline.
+     */
+    uint32_t get_remaining_us() const;
+};
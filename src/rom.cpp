@@ -1,6 +1,6 @@
 #include "rom.hpp"
 
-#include "one_wire.hpp"
+#include "crc8.hpp"
 
 Rom::Rom() {
     m_family_code = 0;
@@ -47,11 +47,8 @@ bool Rom::is_empty() const {
 }
 
 bool Rom::has_valid_crc() const {
-    uint8_t crc = 0;
-    crc = OneWire::calculate_crc_byte(crc, m_family_code);
-    for (int i = 0; i < 6; i++) {
-        crc = OneWire::calculate_crc_byte(crc, m_serial_number[i]);
-    }
+    uint8_t crc = Crc8::update(0, m_family_code);
+    crc = Crc8::calculate(m_serial_number, 6, crc);
     return crc == m_crc_code;
 }
 
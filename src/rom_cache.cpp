@@ -0,0 +1,110 @@
+#include "rom_cache.hpp"
+
+#include <stdio.h>
+#include <cstring>
+#include "crc8.hpp"
+#include "hal.hpp"
+
+namespace {
+    void put_uint(uint8_t* data, uint64_t value, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            data[i] = (value >> (8 * i)) & 0xFF;
+        }
+    }
+
+    uint64_t get_uint(const uint8_t* data, size_t length) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < length; i++) {
+            value |= (uint64_t)data[i] << (8 * i);
+        }
+
+        return value;
+    }
+}
+
+bool RomCache::save(const etl::ivector<Ds18b20>& devices) {
+    if (devices.size() > m_max_devices) {
+        return false;
+    }
+
+    uint8_t data[m_max_size];
+    put_uint(data, m_magic, 4);
+    data[4] = m_version;
+    put_uint(&data[5], devices.size(), 2);
+    size_t length = m_header_size;
+    for (size_t i = 0; i < devices.size(); i++) {
+        const Ds18b20& device = devices[i];
+        put_uint(&data[length], Rom::encode_rom(device.get_rom()), 8);
+        data[length + 8] = device.get_temperature_high_limit();
+        data[length + 9] = device.get_temperature_low_limit();
+        data[length + 10] = device.m_scratchpad.get_configuration();
+        data[length + 11] = static_cast<uint8_t>(device.m_power_supply_mode);
+        length += m_entry_size;
+    }
+    data[length] = Crc8::calculate(data, length);
+    length++;
+
+    // Skip the write if the storage already has the same content
+    uint8_t stored_data[m_max_size];
+    if (Hal::read_storage(stored_data, length) && memcmp(data, stored_data, length) == 0) {
+        return true;
+    }
+
+    return Hal::write_storage(data, length);
+}
+
+bool RomCache::load(OneWire& one_wire, etl::ivector<Ds18b20>& devices) {
+    devices.clear();
+
+    // Check the header
+    uint8_t data[m_max_size];
+    if (!Hal::read_storage(data, m_header_size)) {
+        return false;
+    }
+
+    // An empty cache is a miss: it would skip the search forever, even after devices are connected
+    size_t count = get_uint(&data[5], 2);
+    if (get_uint(data, 4) != m_magic || data[4] != m_version || count == 0 || count > m_max_devices ||
+            count > devices.capacity()) {
+        return false;
+    }
+
+    // Check the CRC code of the whole content
+    size_t length = m_header_size + count * m_entry_size;
+    if (!Hal::read_storage(data, length + 1) || Crc8::calculate(data, length + 1) != 0) {
+        return false;
+    }
+
+    // Validate every device with a single read of its scratchpad prefix
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* entry = &data[m_header_size + i * m_entry_size];
+        Rom rom = Rom::decode_rom(get_uint(entry, 8));
+        Ds18b20 device(one_wire, rom, static_cast<PowerSupplyMode>(entry[11]));
+        if (!device.restore(entry[8], entry[9], entry[10])) {
+            devices.clear();
+            return false;
+        }
+        devices.emplace_back(device);
+    }
+
+    return true;
+}
+
+bool RomCache::find_devices(OneWire& one_wire, etl::ivector<Ds18b20>& devices) {
+    if (load(one_wire, devices)) {
+        printf("Restored %d devices\n", (int)devices.size());
+        return true;
+    }
+
+    Ds18b20::find_devices(one_wire, devices);
+    if (!devices.empty()) {
+        save(devices);
+    }
+
+    return false;
+}
+
+bool RomCache::clear() {
+    uint8_t data[m_header_size] = {};
+    return Hal::write_storage(data, m_header_size);
+}
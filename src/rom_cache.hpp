@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ds18b20.hpp"
+
+/**
+ * Persists the devices of a bus (Roms, settings and power supply modes) in the persistent storage of the Hal (a
+ * reserved flash sector), so that a restart can skip the enumeration of the bus. Instead of one Search ROM per device
+ * plus the reads of their scratchpad and power supply mode, each cached device is validated with a single Match ROM
+ * and a read of the first bytes of its scratchpad.
+ *
+ * The stored data starts with a magic number and a format version, and ends with a CRC code. A storage that was never
+ * written, was written by another format version, is corrupted or holds no devices is treated as empty.
+ *
+ * Devices connected after the cache was saved are not found by load(). A later find_devices() with the known devices
+ * (see Ds18b20::find_devices) picks them up.
+ */
+class RomCache {
+public:
+    static const uint8_t m_version = 1; ///< The format version of the stored data
+
+    static const size_t m_max_devices = 64; ///< The maximum number of devices that can be cached
+
+private:
+    static const uint32_t m_magic = 0x43524442; ///< Marks the storage as holding a Rom cache ("BDRC")
+
+    static const size_t m_header_size = 7; ///< Magic number (4 bytes), format version (1 byte), device count (2 bytes)
+
+    static const size_t m_entry_size = 12; ///< Rom (8 bytes), limits (2 bytes), configuration, power supply mode
+
+    static const size_t m_max_size = m_header_size + m_max_devices * m_entry_size + 1; ///< The size of a full cache, with its CRC code
+
+public:
+
+    /**
+     * Stores the devices. The storage is only written if its content differs, to spare the flash.
+     * @param devices The initialized devices of a bus (at most m_max_devices).
+     * @return True if the devices are stored, false if there are too many of them or the write failed.
+     */
+    static bool save(const etl::ivector<Ds18b20>& devices);
+
+    /**
+     * Restores the stored devices and checks that each of them is connected and still has the stored settings.
+     * @param one_wire The OneWire object of the bus the devices were saved from.
+     * @param devices Filled with the stored devices. Left empty if the cache is invalid.
+     * @return True if the cache is valid and all stored devices responded with their stored settings, false if not.
+     */
+    static bool load(OneWire& one_wire, etl::ivector<Ds18b20>& devices);
+
+    /**
+     * Restores the devices from the cache (see load) or, if it is invalid, enumerates the bus and saves the devices found
+     * (unless none were found, so the next call searches the bus again).
+     * @param one_wire The OneWire object to act upon.
+     * @param devices Filled with the devices.
+     * @return True if the devices were restored from the cache, false if the bus was enumerated.
+     */
+    static bool find_devices(OneWire& one_wire, etl::ivector<Ds18b20>& devices);
+
+    /**
+     * Invalidates the stored data, so the next find_devices() enumerates the bus.
+     * @return True if the write was successful, false if not.
+     */
+    static bool clear();
+};
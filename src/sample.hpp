@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * A temperature measurement of a device, with the times at which it was captured. Returned by
+ * Ds18b20::measure_sample and published by the AcquisitionService.
+ */
+struct Sample {
+    uint64_t rom = 0; ///< The Rom of the device (see Rom::encode_rom)
+    uint64_t timestamp_us = 0; ///< The time (us since boot) at which the temperature was read
+    uint64_t conversion_start_us = 0; ///< The time (us since boot) at which the conversion was requested
+    uint64_t conversion_end_us = 0; ///< The time (us since boot) at which the conversion was found complete
+    uint32_t read_latency_us = 0; ///< The time between the end of the conversion and the temperature being read
+    int16_t temperature = 0; ///< The temperature in 1/16 degree steps (see Temperature::from_raw)
+    uint8_t retries = 0; ///< The number of failed attempts before the measurement succeeded (or failed)
+    uint8_t crc_failures = 0; ///< The number of scratchpad reads rejected because of an invalid CRC
+    bool valid = false; ///< Whether the temperature could be read
+};
@@ -0,0 +1,66 @@
+#include "sample_statistics.hpp"
+
+void SampleStatistics::add(const Sample& sample) {
+    if (!sample.valid) {
+        m_failure_count++;
+        return;
+    }
+
+    // Update the latency
+    uint32_t latency = sample.timestamp_us - sample.conversion_start_us;
+    if (m_count == 0 || latency < m_min_latency_us) {
+        m_min_latency_us = latency;
+    }
+    if (latency > m_max_latency_us) {
+        m_max_latency_us = latency;
+    }
+    m_total_latency_us += latency;
+    m_count++;
+
+    // The jitter is the change of the interval between two conversion requests
+    if (m_count >= 2) {
+        uint32_t interval = sample.conversion_start_us - m_last_conversion_start_us;
+        if (m_count >= 3) {
+            uint32_t jitter = interval > m_last_interval_us ? interval - m_last_interval_us : m_last_interval_us - interval;
+            size_t bucket = 0;
+            while (bucket < m_jitter_bucket_count - 1 && jitter >= (m_jitter_bucket_width_us << bucket)) {
+                bucket++;
+            }
+            m_jitter_histogram[bucket]++;
+        }
+        m_last_interval_us = interval;
+    }
+    m_last_conversion_start_us = sample.conversion_start_us;
+}
+
+void SampleStatistics::clear() {
+    *this = SampleStatistics();
+}
+
+uint32_t SampleStatistics::get_count() const {
+    return m_count;
+}
+
+uint32_t SampleStatistics::get_failure_count() const {
+    return m_failure_count;
+}
+
+uint32_t SampleStatistics::get_min_latency_us() const {
+    return m_min_latency_us;
+}
+
+uint32_t SampleStatistics::get_max_latency_us() const {
+    return m_max_latency_us;
+}
+
+uint32_t SampleStatistics::get_mean_latency_us() const {
+    if (m_count == 0) {
+        return 0;
+    }
+
+    return m_total_latency_us / m_count;
+}
+
+uint32_t SampleStatistics::get_jitter_count(size_t bucket) const {
+    return m_jitter_histogram[bucket];
+}
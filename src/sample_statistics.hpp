@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "sample.hpp"
+
+/**
+ * Rolling statistics of the samples of a device: the latency of the measurements (from the request of the
+ * conversion to the temperature being read) and a histogram of the scheduling jitter (the difference between
+ * two consecutive intervals between conversion requests). Updated with each sample, so it can be queried
+ * without any bus traffic.
+ */
+class SampleStatistics {
+public:
+    static const size_t m_jitter_bucket_count = 8; ///< The number of buckets of the jitter histogram
+
+    static const uint32_t m_jitter_bucket_width_us = 64; ///< The upper bound of the first bucket. Doubles with each bucket.
+
+private:
+    uint32_t m_count = 0; ///< The number of valid samples
+    uint32_t m_failure_count = 0; ///< The number of failed samples
+    uint32_t m_min_latency_us = 0; ///< The lowest latency of a valid sample
+    uint32_t m_max_latency_us = 0; ///< The highest latency of a valid sample
+    uint64_t m_total_latency_us = 0; ///< The sum of the latencies of the valid samples
+    uint64_t m_last_conversion_start_us = 0; ///< The conversion start of the previous sample
+    uint32_t m_last_interval_us = 0; ///< The interval between the conversion starts of the two previous samples
+    uint32_t m_jitter_histogram[m_jitter_bucket_count] = {}; ///< The number of intervals per jitter bucket
+
+public:
+    /**
+     * Updates the statistics with a new sample.
+     */
+    void add(const Sample& sample);
+
+    /**
+     * Resets the statistics.
+     */
+    void clear();
+
+    /**
+     * @return The number of valid samples.
+     */
+    uint32_t get_count() const;
+
+    /**
+     * @return The number of failed samples.
+     */
+    uint32_t get_failure_count() const;
+
+    /**
+     * @return The lowest latency of a valid sample, in microseconds. 0 if there is none.
+     */
+    uint32_t get_min_latency_us() const;
+
+    /**
+     * @return The highest latency of a valid sample, in microseconds. 0 if there is none.
+     */
+    uint32_t get_max_latency_us() const;
+
+    /**
+     * @return The mean latency of the valid samples, in microseconds. 0 if there is none.
+     */
+    uint32_t get_mean_latency_us() const;
+
+    /**
+     * @param bucket The index of the bucket. Bucket i counts the jitters below m_jitter_bucket_width_us << i
+     * (and above the previous bucket), the last bucket counts all larger jitters.
+     * @return The number of intervals whose jitter falls into the bucket.
+     */
+    uint32_t get_jitter_count(size_t bucket) const;
+};
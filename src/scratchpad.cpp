@@ -1,6 +1,7 @@
 #include "scratchpad.hpp"
 
-#include "one_wire.hpp"
+#include "crc8.hpp"
+#include "temperature.hpp"
 
 Scratchpad::Scratchpad() {
     for (int i = 0; i < 2; i++) {
@@ -32,6 +33,11 @@ uint8_t Scratchpad::get_temperature_byte(int index) const {
     return m_temperature[index];
 }
 
+void Scratchpad::set_temperature_bytes(const uint8_t temperature[2]) {
+    m_temperature[0] = temperature[0];
+    m_temperature[1] = temperature[1];
+}
+
 int8_t Scratchpad::get_temperature_high_limit() const {
     return m_temperature_high_limit;
 }
@@ -48,12 +54,18 @@ uint8_t Scratchpad::get_crc_code() const {
     return m_crc_code;
 }
 
-float Scratchpad::calculate_temperature() const {
+int16_t Scratchpad::get_raw_temperature() const {
     uint8_t config_setting = get_config_setting();
     int16_t temperature_data = m_temperature[0] + (m_temperature[1] << 8);
-    temperature_data = temperature_data >> (3 - config_setting);
-    float temperature = temperature_data / (float)(1 << (config_setting + 1));
-    return temperature;
+    return temperature_data & ~((1 << (3 - config_setting)) - 1);
+}
+
+int32_t Scratchpad::calculate_temperature_centi() const {
+    return Temperature<4>::from_raw(get_raw_temperature()).to_centi_degrees();
+}
+
+float Scratchpad::calculate_temperature() const {
+    return get_raw_temperature() / 16.0f;
 }
 
 uint8_t Scratchpad::get_config_setting() const {
@@ -69,15 +81,10 @@ int Scratchpad::get_resolution() const {
 }
 
 bool Scratchpad::has_valid_crc() const {
-    uint8_t crc = 0;
-    for (int i = 0; i < 2; i++) {
-        crc = OneWire::calculate_crc_byte(crc, m_temperature[i]);
-    }
-    crc = OneWire::calculate_crc_byte(crc, m_temperature_high_limit);
-    crc = OneWire::calculate_crc_byte(crc, m_temperature_low_limit);
-    crc = OneWire::calculate_crc_byte(crc, m_configuration);
-    for (int i = 0; i < 3; i++) {
-        crc = OneWire::calculate_crc_byte(crc, m_reserved[i]);
-    }
+    uint8_t crc = Crc8::calculate(m_temperature, 2);
+    crc = Crc8::update(crc, m_temperature_high_limit);
+    crc = Crc8::update(crc, m_temperature_low_limit);
+    crc = Crc8::update(crc, m_configuration);
+    crc = Crc8::calculate(m_reserved, 3, crc);
     return crc == m_crc_code;
 }
@@ -45,6 +45,13 @@ public:
      */
     uint8_t get_temperature_byte(int index) const;
 
+    /**
+     * Replaces the 2 bytes of the temperature measurement, after only they were read. The CRC code no longer matches
+     * the scratchpad afterwards.
+     * @param temperature The 2 bytes of the temperature measurement (index 0 is LSB).
+     */
+    void set_temperature_bytes(const uint8_t temperature[2]);
+
     /**
      * @return The upper temperature limit for triggering the alarm.
      */
@@ -65,6 +72,20 @@ public:
      */
     uint8_t get_crc_code() const;
 
+    /**
+     * Converts the 2 bytes of the temperature measurement to a fixed-point number. The bits that are undefined
+     * in the current resolution are cleared.
+     * @return The temperature measurement in 1/16 degree steps.
+     */
+    int16_t get_raw_temperature() const;
+
+    /**
+     * Converts the 2 bytes of the temperature measurement to hundredths of a degree (rounded to the nearest),
+     * without using floating point arithmetic.
+     * @return The temperature measurement in 1/100 degree steps.
+     */
+    int32_t calculate_temperature_centi() const;
+
     /**
      * Converts the 2 bytes of the temperature measurement to a float number.
      * @return The temperature measurement in a readable format.
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * A lock-free single-producer/single-consumer ring buffer. One core (or thread) pushes, another one pops,
+ * without locks or interrupts being disabled. Only atomic loads and stores of 32-bit indices are used, which
+ * are lock-free on the RP2040. If the ring is full, push() drops the item and counts it as an overflow.
+ * @tparam T The type of the items.
+ * @tparam Capacity The maximum number of items. Must be a power of 2.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+private:
+    T m_items[Capacity]; ///< The storage of the items
+    std::atomic<uint32_t> m_head{0}; ///< The number of items pushed (written by the producer only)
+    std::atomic<uint32_t> m_tail{0}; ///< The number of items popped (written by the consumer only)
+    std::atomic<uint32_t> m_overflow_count{0}; ///< The number of items dropped (written by the producer only)
+
+public:
+    /**
+     * Adds an item to the ring. Must only be called by the producer.
+     * @return True if the item was added, false if the ring was full (the item is dropped).
+     */
+    bool push(const T& item) {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        uint32_t tail = m_tail.load(std::memory_order_acquire);
+        if (head - tail >= Capacity) {
+            m_overflow_count.store(m_overflow_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_items[head & (Capacity - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Removes the oldest item from the ring. Must only be called by the consumer.
+     * @param item Set to the removed item.
+     * @return True if an item was removed, false if the ring was empty.
+     */
+    bool pop(T& item) {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        uint32_t head = m_head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+
+        item = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @return The number of items in the ring (may be outdated by the time it is used).
+     */
+    size_t size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The number of items dropped because the ring was full.
+     */
+    uint32_t get_overflow_count() const {
+        return m_overflow_count.load(std::memory_order_relaxed);
+    }
+};
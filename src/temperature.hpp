@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * A fixed-point temperature in degrees Celsius with FractionBits fractional bits (the value is stored in
+ * 1 / 2^FractionBits degree steps). All conversions are integer-only, so no floating point routines are needed
+ * on devices without an FPU.
+ */
+template <int FractionBits>
+class Temperature {
+    static_assert(FractionBits >= 0 && FractionBits <= 16, "FractionBits must be in the range [0, 16]");
+
+private:
+    int32_t m_value; ///< The temperature in 1 / 2^FractionBits degree steps
+
+    constexpr explicit Temperature(int32_t value) : m_value(value) {}
+
+public:
+    /**
+     * Creates a temperature of 0 degrees.
+     */
+    constexpr Temperature() : m_value(0) {}
+
+    /**
+     * Creates a temperature from the raw measurement of a ds18b20 (1/16 degree steps).
+     * @param raw The raw temperature (see Scratchpad::get_raw_temperature).
+     */
+    static constexpr Temperature from_raw(int16_t raw) {
+        if (FractionBits >= 4) {
+            return Temperature((int32_t)raw * (1 << (FractionBits - 4)));
+        } else {
+            return Temperature((int32_t)raw >> (4 - FractionBits));
+        }
+    }
+
+    /**
+     * Creates a temperature from whole degrees.
+     */
+    static constexpr Temperature from_degrees(int32_t degrees) {
+        return Temperature(degrees * (1 << FractionBits));
+    }
+
+    /**
+     * @return The temperature in 1 / 2^FractionBits degree steps.
+     */
+    constexpr int32_t get_value() const {
+        return m_value;
+    }
+
+    /**
+     * @return The temperature in whole degrees (rounded towards negative infinity).
+     */
+    constexpr int32_t to_degrees() const {
+        return m_value >> FractionBits;
+    }
+
+    /**
+     * @return The temperature in hundredths of a degree (rounded to the nearest).
+     */
+    constexpr int32_t to_centi_degrees() const {
+        int32_t half = (1 << FractionBits) / 2;
+        if (m_value >= 0) {
+            return (m_value * 100 + half) >> FractionBits;
+        } else {
+            return -((-m_value * 100 + half) >> FractionBits);
+        }
+    }
+
+    /**
+     * @return The temperature as a floating point number.
+     */
+    constexpr float to_float() const {
+        return m_value / (float)(1 << FractionBits);
+    }
+
+    constexpr bool operator==(const Temperature& other) const { return m_value == other.m_value; }
+    constexpr bool operator!=(const Temperature& other) const { return m_value != other.m_value; }
+    constexpr bool operator<(const Temperature& other) const { return m_value < other.m_value; }
+    constexpr bool operator<=(const Temperature& other) const { return m_value <= other.m_value; }
+    constexpr bool operator>(const Temperature& other) const { return m_value > other.m_value; }
+    constexpr bool operator>=(const Temperature& other) const { return m_value >= other.m_value; }
+};
@@ -0,0 +1,32 @@
+#include <stdio.h>
+
+#include "bus_simulator.hpp"
+#include "one_wire.hpp"
+#include "simulation.hpp"
+
+// From examples/benchmark.cpp, whose main() is renamed by test/CMakeLists.txt
+void print_header();
+void run_benchmark(OneWire& one_wire);
+
+/**
+ * Runs the benchmark example against a simulated bus on pin 0 with 1 to 64 devices, and prints its CSV results.
+ * The devices are added to the same bus between the runs.
+ */
+int main() {
+    Simulation::reset();
+    BusSimulator bus(0);
+    OneWire one_wire(0);
+    print_header();
+
+    const size_t device_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    for (size_t device_count : device_counts) {
+        while (bus.get_device_count() < device_count) {
+            uint64_t i = bus.get_device_count() + 1;
+            bus.add_device(i * 0x10101).set_temperature(20.0f + i * 0.25f);
+        }
+        run_benchmark(one_wire);
+    }
+    fflush(stdout);
+
+    return 0;
+}
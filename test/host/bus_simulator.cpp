@@ -0,0 +1,670 @@
+#include "bus_simulator.hpp"
+
+#include <cmath>
+
+#include "simulation.hpp"
+
+namespace {
+
+// The timing of the devices and the limits of the protocol, in nanoseconds (standard speed, overdrive speed)
+const uint64_t reset_min_ns[2] = { 480000, 48000 };
+const uint64_t sample_delay_ns[2] = { 30000, 3000 };
+const uint64_t hold_ns[2] = { 30000, 3000 };
+const uint64_t presence_delay_ns[2] = { 30000, 3000 };
+const uint64_t presence_low_ns[2] = { 120000, 10000 };
+const uint64_t write_1_low_max_ns[2] = { 15000, 2000 };
+const uint64_t write_0_low_min_ns[2] = { 60000, 6000 };
+const uint64_t write_0_low_max_ns[2] = { 120000, 16000 };
+const uint64_t read_sample_max_ns[2] = { 15000, 2000 };
+const uint64_t slot_min_ns[2] = { 60000, 6000 };
+const uint64_t low_min_ns = 1000;
+const uint64_t recovery_min_ns = 1000;
+const uint64_t copy_time_ns = 10000000;
+const uint64_t strong_pullup_delay_max_ns = 100000;
+
+uint8_t crc8(const uint8_t* data, size_t length) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        for (int b = 0; b < 8; b++) {
+            bool mix = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            byte >>= 1;
+        }
+    }
+
+    return crc;
+}
+
+}
+
+SimulatedDevice::SimulatedDevice(BusSimulator& bus, uint64_t serial_number, bool parasite) : m_bus(bus), m_parasite(parasite) {
+    m_rom[0] = 0x28;
+    for (int i = 0; i < 6; i++) {
+        m_rom[i + 1] = (serial_number >> (8 * i)) & 0xFF;
+    }
+    m_rom[7] = crc8(m_rom, 7);
+    m_random ^= (uint32_t)serial_number;
+}
+
+uint64_t SimulatedDevice::get_rom() const {
+    uint64_t rom = 0;
+    for (int i = 0; i < 8; i++) {
+        rom |= (uint64_t)m_rom[i] << (8 * i);
+    }
+
+    return rom;
+}
+
+void SimulatedDevice::set_temperature(float temperature) {
+    m_temperature = (int16_t)std::lround(temperature * 16);
+}
+
+void SimulatedDevice::set_raw_temperature(int16_t temperature) {
+    m_temperature = temperature;
+}
+
+void SimulatedDevice::set_connected(bool connected) {
+    m_connected = connected;
+    m_driving_low = false;
+    m_phase = Phase::Idle;
+}
+
+void SimulatedDevice::set_overdrive_capable(bool capable) {
+    m_overdrive_capable = capable;
+}
+
+void SimulatedDevice::set_bit_error_rate(double rate) {
+    m_bit_error_rate = rate;
+}
+
+void SimulatedDevice::set_corrupted_scratchpad_writes(uint32_t count) {
+    m_corrupted_writes = count;
+}
+
+void SimulatedDevice::set_conversion_time_us(int resolution, uint32_t time_us) {
+    m_conversion_time_ns[resolution] = time_us * 1000ull;
+}
+
+void SimulatedDevice::set_eeprom(int8_t temperature_high, int8_t temperature_low, uint8_t configuration) {
+    m_eeprom[0] = temperature_high;
+    m_eeprom[1] = temperature_low;
+    m_eeprom[2] = configuration;
+    m_scratchpad_high = temperature_high;
+    m_scratchpad_low = temperature_low;
+    m_scratchpad_configuration = configuration;
+}
+
+int8_t SimulatedDevice::get_eeprom_temperature_high() const {
+    return m_eeprom[0];
+}
+
+int8_t SimulatedDevice::get_eeprom_temperature_low() const {
+    return m_eeprom[1];
+}
+
+uint8_t SimulatedDevice::get_eeprom_configuration() const {
+    return m_eeprom[2];
+}
+
+uint8_t SimulatedDevice::get_scratchpad_configuration() const {
+    return m_scratchpad_configuration;
+}
+
+bool SimulatedDevice::is_overdrive() const {
+    return m_overdrive;
+}
+
+bool SimulatedDevice::is_parasite() const {
+    return m_parasite;
+}
+
+uint32_t SimulatedDevice::get_conversions() const {
+    return m_conversions;
+}
+
+uint32_t SimulatedDevice::get_eeprom_writes() const {
+    return m_eeprom_writes;
+}
+
+uint32_t SimulatedDevice::get_scratchpad_reads() const {
+    return m_scratchpad_reads;
+}
+
+bool SimulatedDevice::is_driving_low() const {
+    return m_connected && m_driving_low;
+}
+
+bool SimulatedDevice::next_random_error() {
+    if (m_bit_error_rate <= 0) {
+        return false;
+    }
+
+    m_random = m_random * 1103515245u + 12345u;
+    return ((m_random >> 8) / 16777216.0) < m_bit_error_rate;
+}
+
+void SimulatedDevice::queue_bytes(const uint8_t* data, size_t length) {
+    m_transmit_bits.clear();
+    m_transmit_index = 0;
+    for (size_t i = 0; i < length; i++) {
+        for (int b = 0; b < 8; b++) {
+            m_transmit_bits.push_back((data[i] >> b) & 0x01);
+        }
+    }
+}
+
+void SimulatedDevice::update(uint64_t now_ns) {
+    if (m_operation != Operation::None && now_ns >= m_operation_end_ns) {
+        finish_operation(now_ns);
+    }
+}
+
+void SimulatedDevice::finish_operation(uint64_t now_ns) {
+    (void)now_ns;
+    bool powered = !m_parasite || (m_strong_pullup_seen && !m_power_lost);
+    if (m_operation == Operation::Conversion) {
+        if (powered) {
+            // The undefined low bits of the lower resolutions read as 0
+            int resolution = (m_scratchpad_configuration >> 5) & 0x03;
+            m_temperature_register = m_temperature & ~((1 << (3 - resolution)) - 1);
+        } else {
+            m_temperature_register = m_power_on_temperature;
+        }
+        int8_t temperature = m_temperature_register >> 4;
+        m_alarm = temperature >= (int8_t)m_scratchpad_high || temperature <= (int8_t)m_scratchpad_low;
+    } else if (m_operation == Operation::Copy && powered) {
+        m_eeprom[0] = m_scratchpad_high;
+        m_eeprom[1] = m_scratchpad_low;
+        m_eeprom[2] = m_scratchpad_configuration;
+        m_eeprom_writes++;
+    }
+    m_operation = Operation::None;
+}
+
+bool SimulatedDevice::on_reset(uint64_t now_ns, uint64_t low_ns) {
+    if (!m_connected) {
+        return false;
+    }
+
+    // A standard speed reset also returns overdrive devices to standard speed
+    if (low_ns >= reset_min_ns[0]) {
+        m_overdrive = false;
+    } else if (!m_overdrive || low_ns < reset_min_ns[1]) {
+        return false;
+    }
+
+    m_phase = Phase::RomCommand;
+    m_received_bits = 0;
+    m_received_byte = 0;
+    m_driving_low = false;
+    m_drive_generation++;
+    m_bus.schedule(now_ns + presence_delay_ns[m_overdrive], this, BusSimulator::EventType::PresenceStart, m_drive_generation);
+    m_bus.schedule(now_ns + presence_delay_ns[m_overdrive] + presence_low_ns[m_overdrive], this, BusSimulator::EventType::PresenceEnd,
+        m_drive_generation);
+
+    return true;
+}
+
+void SimulatedDevice::on_presence(uint32_t generation, bool start) {
+    if (generation == m_drive_generation) {
+        m_driving_low = start;
+    }
+}
+
+void SimulatedDevice::on_release(uint32_t generation) {
+    if (generation == m_drive_generation) {
+        m_driving_low = false;
+    }
+}
+
+void SimulatedDevice::on_slot_start(uint64_t now_ns) {
+    if (!m_connected) {
+        return;
+    }
+    update(now_ns);
+
+    // Find out whether the device sends or receives in this slot
+    int bit = -1;
+    switch (m_phase) {
+        case Phase::Idle:
+            return;
+        case Phase::Transmit:
+            if (m_transmit_index < m_transmit_bits.size()) {
+                bit = m_transmit_bits[m_transmit_index++];
+                if (m_transmit_index == m_transmit_bits.size()) {
+                    m_phase = m_after_transmit_phase;
+                }
+            } else {
+                bit = 1;
+            }
+            break;
+        case Phase::Status:
+            bit = m_parasite || m_operation == Operation::None;
+            break;
+        case Phase::Search:
+            if (m_search_step < 2) {
+                bool rom_bit = (m_rom[m_bit_index / 8] >> (m_bit_index % 8)) & 0x01;
+                bit = (m_search_step == 0) ? rom_bit : !rom_bit;
+                m_search_step++;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (bit < 0) {
+        m_bus.schedule(now_ns + sample_delay_ns[m_overdrive], this, BusSimulator::EventType::Sample);
+        return;
+    }
+    if (next_random_error()) {
+        bit = !bit;
+    }
+    if (bit == 0) {
+        m_driving_low = true;
+        m_drive_generation++;
+        m_bus.schedule(now_ns + hold_ns[m_overdrive], this, BusSimulator::EventType::Release, m_drive_generation);
+    }
+}
+
+void SimulatedDevice::on_sample(uint64_t now_ns, bool level) {
+    if (!m_connected) {
+        return;
+    }
+
+    switch (m_phase) {
+        case Phase::RomCommand:
+        case Phase::FunctionCommand:
+        case Phase::WriteScratchpad:
+            m_received_byte |= level << m_received_bits;
+            m_received_bits++;
+            if (m_received_bits == 8) {
+                uint8_t byte = m_received_byte;
+                m_received_bits = 0;
+                m_received_byte = 0;
+                on_byte(byte, now_ns);
+            }
+            break;
+        case Phase::MatchRom:
+            if (level != ((m_rom[m_bit_index / 8] >> (m_bit_index % 8)) & 0x01)) {
+                m_phase = Phase::Idle;
+            } else if (++m_bit_index == 64) {
+                m_phase = Phase::FunctionCommand;
+            }
+            break;
+        case Phase::Search:
+            if (level != ((m_rom[m_bit_index / 8] >> (m_bit_index % 8)) & 0x01)) {
+                m_phase = Phase::Idle;
+            } else if (++m_bit_index == 64) {
+                m_phase = Phase::FunctionCommand;
+            }
+            m_search_step = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+void SimulatedDevice::on_byte(uint8_t byte, uint64_t now_ns) {
+    if (m_phase == Phase::RomCommand) {
+        m_bit_index = 0;
+        m_search_step = 0;
+        switch (byte) {
+            case 0x33:
+                queue_bytes(m_rom, 8);
+                m_phase = Phase::Transmit;
+                m_after_transmit_phase = Phase::FunctionCommand;
+                break;
+            case 0x55:
+                m_phase = Phase::MatchRom;
+                break;
+            case 0xCC:
+                m_phase = Phase::FunctionCommand;
+                break;
+            case 0xF0:
+                m_phase = Phase::Search;
+                break;
+            case 0xEC:
+                m_phase = m_alarm ? Phase::Search : Phase::Idle;
+                break;
+            case 0x3C:
+            case 0x69:
+                if (!m_overdrive_capable) {
+                    m_phase = Phase::Idle;
+                    break;
+                }
+                m_overdrive = true;
+                m_bus.set_overdrive(true);
+                m_phase = (byte == 0x3C) ? Phase::FunctionCommand : Phase::MatchRom;
+                break;
+            default:
+                m_phase = Phase::Idle;
+                break;
+        }
+        return;
+    }
+
+    if (m_phase == Phase::WriteScratchpad) {
+        m_write_buffer[m_write_count++] = byte;
+        if (m_write_count == 3) {
+            m_scratchpad_high = m_write_buffer[0];
+            m_scratchpad_low = m_write_buffer[1];
+            m_scratchpad_configuration = (m_write_buffer[2] & 0x60) | 0x1F;
+            if (m_corrupted_writes > 0) {
+                m_corrupted_writes--;
+                m_scratchpad_high ^= 0x01;
+            }
+            m_phase = Phase::Idle;
+        }
+        return;
+    }
+
+    switch (byte) {
+        case 0x44: {
+            int resolution = (m_scratchpad_configuration >> 5) & 0x03;
+            m_operation = Operation::Conversion;
+            m_operation_start_ns = now_ns;
+            m_operation_end_ns = now_ns + m_conversion_time_ns[resolution];
+            m_strong_pullup_seen = false;
+            m_power_lost = false;
+            m_conversions++;
+            m_phase = Phase::Status;
+            break;
+        }
+        case 0xBE: {
+            uint8_t scratchpad[9] = { (uint8_t)(m_temperature_register & 0xFF), (uint8_t)(m_temperature_register >> 8),
+                m_scratchpad_high, m_scratchpad_low, m_scratchpad_configuration, 0xFF, 0x0C, 0x10, 0 };
+            scratchpad[8] = crc8(scratchpad, 8);
+            queue_bytes(scratchpad, 9);
+            m_scratchpad_reads++;
+            m_phase = Phase::Transmit;
+            m_after_transmit_phase = Phase::Idle;
+            break;
+        }
+        case 0x4E:
+            m_write_count = 0;
+            m_phase = Phase::WriteScratchpad;
+            break;
+        case 0x48:
+            m_operation = Operation::Copy;
+            m_operation_start_ns = now_ns;
+            m_operation_end_ns = now_ns + copy_time_ns;
+            m_strong_pullup_seen = false;
+            m_power_lost = false;
+            m_phase = Phase::Status;
+            break;
+        case 0xB8:
+            m_scratchpad_high = m_eeprom[0];
+            m_scratchpad_low = m_eeprom[1];
+            m_scratchpad_configuration = m_eeprom[2];
+            m_phase = Phase::Status;
+            break;
+        case 0xB4: {
+            uint8_t power_supply = m_parasite ? 0x00 : 0x01;
+            queue_bytes(&power_supply, 1);
+            m_transmit_bits.resize(1);
+            m_phase = Phase::Transmit;
+            m_after_transmit_phase = Phase::Idle;
+            break;
+        }
+        default:
+            m_phase = Phase::Idle;
+            break;
+    }
+}
+
+void SimulatedDevice::on_master_change(uint64_t now_ns, bool strong_high) {
+    if (!m_connected || !m_parasite || m_operation == Operation::None || now_ns >= m_operation_end_ns) {
+        return;
+    }
+
+    // In parasite power mode, the strong pull-up must be enabled right after the command and held until the end
+    if (strong_high && !m_strong_pullup_seen) {
+        m_strong_pullup_seen = true;
+        m_power_lost = now_ns > m_operation_start_ns + strong_pullup_delay_max_ns;
+    } else if (!strong_high && m_strong_pullup_seen) {
+        m_power_lost = true;
+    }
+}
+
+BusSimulator::BusSimulator(int pin) : m_pin(pin) {
+    Simulation::attach_bus(this);
+}
+
+BusSimulator::~BusSimulator() {
+    Simulation::detach_bus(this);
+}
+
+SimulatedDevice& BusSimulator::add_device(uint64_t serial_number, bool parasite) {
+    m_devices.push_back(std::unique_ptr<SimulatedDevice>(new SimulatedDevice(*this, serial_number, parasite)));
+    return *m_devices.back();
+}
+
+SimulatedDevice& BusSimulator::get_device(size_t index) {
+    return *m_devices[index];
+}
+
+size_t BusSimulator::get_device_count() const {
+    return m_devices.size();
+}
+
+void BusSimulator::set_recording(bool recording) {
+    m_recording = recording;
+}
+
+const std::vector<SlotRecord>& BusSimulator::get_records() const {
+    return m_records;
+}
+
+const std::vector<std::vector<uint8_t>>& BusSimulator::get_frames() const {
+    return m_frames;
+}
+
+void BusSimulator::clear_records() {
+    m_records.clear();
+    m_frames.clear();
+    m_frame_bits = 0;
+    m_frame_byte = 0;
+    m_resets = 0;
+    m_slots = 0;
+    m_timing_violations = 0;
+}
+
+uint32_t BusSimulator::get_resets() const {
+    return m_resets;
+}
+
+uint32_t BusSimulator::get_slots() const {
+    return m_slots;
+}
+
+uint32_t BusSimulator::get_timing_violations() const {
+    return m_timing_violations;
+}
+
+bool BusSimulator::get_level() const {
+    if (m_master_low) {
+        return false;
+    }
+    for (const std::unique_ptr<SimulatedDevice>& device : m_devices) {
+        if (device->is_driving_low()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool BusSimulator::read() {
+    uint64_t now_ns = Simulation::get_time_ns();
+
+    // The first read after the release of a short slot is the sampling of a read slot
+    if (m_in_slot && !m_slot_is_reset && !m_master_low && !m_sampled) {
+        m_sampled = true;
+        uint64_t sample_ns = now_ns - m_fall_ns;
+        if (m_low_ns <= write_1_low_max_ns[m_overdrive] && sample_ns > read_sample_max_ns[m_overdrive]) {
+            m_timing_violations++;
+        }
+        if (m_recording && !m_records.empty()) {
+            m_records.back().sample_ns = sample_ns;
+        }
+    }
+
+    return get_level();
+}
+
+bool BusSimulator::is_strong_high() const {
+    return m_strong_high;
+}
+
+bool BusSimulator::is_overdrive() const {
+    return m_overdrive;
+}
+
+int BusSimulator::get_pin() const {
+    return m_pin;
+}
+
+void BusSimulator::set_sio_direction(bool output) {
+    m_sio_output = output;
+    update_master();
+}
+
+void BusSimulator::set_sio_value(bool value) {
+    m_sio_value = value;
+    update_master();
+}
+
+void BusSimulator::set_pio_function(bool enabled) {
+    m_pio_function = enabled;
+    update_master();
+}
+
+void BusSimulator::set_pio_output(bool output) {
+    m_pio_output = output;
+    update_master();
+}
+
+void BusSimulator::update_master() {
+    uint64_t now_ns = Simulation::get_time_ns();
+    bool master_low = m_pio_function ? m_pio_output : (m_sio_output && !m_sio_value);
+    bool strong_high = !m_pio_function && m_sio_output && m_sio_value;
+
+    bool changed = master_low != m_master_low || strong_high != m_strong_high;
+    bool fall = master_low && !m_master_low;
+    bool rise = !master_low && m_master_low;
+    m_master_low = master_low;
+    m_strong_high = strong_high;
+    if (changed) {
+        for (const std::unique_ptr<SimulatedDevice>& device : m_devices) {
+            device->on_master_change(now_ns, strong_high);
+        }
+    }
+
+    if (fall) {
+        on_fall(now_ns);
+    } else if (rise) {
+        on_rise(now_ns);
+    }
+}
+
+void BusSimulator::on_fall(uint64_t now_ns) {
+    // Check the recovery time and the length of the previous slot
+    if (m_started) {
+        if (now_ns - m_rise_ns < recovery_min_ns) {
+            m_timing_violations++;
+        }
+        if (!m_slot_is_reset && now_ns - m_fall_ns < slot_min_ns[m_overdrive]) {
+            m_timing_violations++;
+        }
+    }
+    m_started = true;
+    m_in_slot = true;
+    m_slot_is_reset = false;
+    m_sampled = false;
+    m_fall_ns = now_ns;
+
+    for (const std::unique_ptr<SimulatedDevice>& device : m_devices) {
+        device->on_slot_start(now_ns);
+    }
+}
+
+void BusSimulator::on_rise(uint64_t now_ns) {
+    m_rise_ns = now_ns;
+    m_low_ns = now_ns - m_fall_ns;
+    m_slot_is_reset = m_low_ns >= reset_min_ns[0] || (m_overdrive && m_low_ns >= reset_min_ns[1]);
+    if (m_low_ns >= reset_min_ns[0]) {
+        m_overdrive = false;
+    }
+    bool overdrive = m_overdrive;
+    for (const std::unique_ptr<SimulatedDevice>& device : m_devices) {
+        device->on_reset(now_ns, m_low_ns);
+    }
+
+    if (m_recording) {
+        m_records.push_back({ m_fall_ns, m_low_ns, -1, m_slot_is_reset, overdrive });
+    }
+    if (m_slot_is_reset) {
+        m_resets++;
+        if (m_recording) {
+            m_frames.emplace_back();
+        }
+        m_frame_bits = 0;
+        m_frame_byte = 0;
+        return;
+    }
+
+    m_slots++;
+    if (m_low_ns < low_min_ns || (m_low_ns > write_1_low_max_ns[overdrive] && m_low_ns < write_0_low_min_ns[overdrive]) ||
+            (m_low_ns > write_0_low_max_ns[overdrive])) {
+        m_timing_violations++;
+    }
+
+    // Decode the bit written by the master
+    bool bit = m_low_ns <= write_1_low_max_ns[overdrive];
+    m_frame_byte |= bit << m_frame_bits;
+    if (++m_frame_bits == 8) {
+        if (m_recording) {
+            if (m_frames.empty()) {
+                m_frames.emplace_back();
+            }
+            m_frames.back().push_back(m_frame_byte);
+        }
+        m_frame_bits = 0;
+        m_frame_byte = 0;
+    }
+}
+
+void BusSimulator::schedule(uint64_t time_ns, SimulatedDevice* device, EventType type, uint32_t generation) {
+    m_events.push({ time_ns, m_event_order++, device, type, generation });
+}
+
+void BusSimulator::set_overdrive(bool overdrive) {
+    m_overdrive = overdrive;
+}
+
+uint64_t BusSimulator::get_next_event_ns() const {
+    return m_events.empty() ? UINT64_MAX : m_events.top().time_ns;
+}
+
+void BusSimulator::process_event() {
+    Event event = m_events.top();
+    m_events.pop();
+    switch (event.type) {
+        case EventType::Sample:
+            event.device->on_sample(event.time_ns, get_level());
+            break;
+        case EventType::Release:
+            event.device->on_release(event.generation);
+            break;
+        case EventType::PresenceStart:
+            event.device->on_presence(event.generation, true);
+            break;
+        case EventType::PresenceEnd:
+            event.device->on_presence(event.generation, false);
+            break;
+    }
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <queue>
+#include <vector>
+#include <memory>
+
+class BusSimulator;
+
+/// A reset or time slot issued by the master, as seen on the bus
+struct SlotRecord {
+    uint64_t start_ns; ///< The time at which the master pulled the bus low
+    uint64_t low_ns; ///< The time the master kept the bus low
+    int64_t sample_ns; ///< The time between the start of the slot and the first read of the bus by the master, -1 if none
+    bool reset; ///< Whether the low time was long enough to reset the devices
+    bool overdrive; ///< Whether the bus was at overdrive speed
+};
+
+/**
+ * A virtual ds18b20 connected to a BusSimulator. It follows the waveform of the bus like the real device: it detects
+ * resets and time slots from the falling and rising edges of the master, samples the written bits 30 us after the
+ * falling edge (3 us at overdrive speed) and holds the bus low for 30 us (3 us) to read a 0. It implements the ROM
+ * commands (including Overdrive Skip/Match ROM if overdrive capable) and the function commands of the ds18b20,
+ * with the conversion latency of each resolution and parasite power.
+ */
+class SimulatedDevice {
+public:
+    /// The power-on value of the temperature register (85 degrees)
+    static const int16_t m_power_on_temperature = 0x0550;
+
+private:
+    enum class Phase {
+        Idle, ///< Not selected, waits for the next reset
+        RomCommand, ///< Receives the ROM command
+        MatchRom, ///< Compares the Rom sent by the master
+        Search, ///< Takes part in a Search ROM or Search Alarm
+        FunctionCommand, ///< Receives the function command
+        WriteScratchpad, ///< Receives TH, TL and the configuration
+        Transmit, ///< Sends the bits queued in m_transmit_bits
+        Status ///< Sends its busy status (conversion or copy in progress)
+    };
+
+    BusSimulator& m_bus;
+    uint8_t m_rom[8];
+    bool m_parasite;
+    bool m_connected = true;
+    bool m_overdrive_capable = false;
+    bool m_overdrive = false;
+
+    Phase m_phase = Phase::Idle;
+    uint8_t m_received_byte = 0;
+    int m_received_bits = 0;
+    int m_bit_index = 0;
+    int m_search_step = 0;
+    Phase m_after_transmit_phase = Phase::Idle;
+    std::vector<bool> m_transmit_bits;
+    size_t m_transmit_index = 0;
+    uint8_t m_write_buffer[3] = {};
+    int m_write_count = 0;
+
+    bool m_driving_low = false;
+    uint32_t m_drive_generation = 0; ///< Invalidates the scheduled releases when the device drives the bus again
+
+    int16_t m_temperature = 0x0190; ///< The temperature of the device (25 degrees)
+    int16_t m_temperature_register = m_power_on_temperature;
+    uint8_t m_scratchpad_high = 75; ///< TH
+    uint8_t m_scratchpad_low = 70; ///< TL
+    uint8_t m_scratchpad_configuration = 0x7F;
+    uint8_t m_eeprom[3] = { 75, 70, 0x7F };
+    bool m_alarm = false;
+
+    // The operation in progress (conversion or copy), which needs the strong pull-up in parasite power mode
+    enum class Operation { None, Conversion, Copy };
+    Operation m_operation = Operation::None;
+    uint64_t m_operation_start_ns = 0;
+    uint64_t m_operation_end_ns = 0;
+    bool m_strong_pullup_seen = false;
+    bool m_power_lost = false;
+
+    uint64_t m_conversion_time_ns[4] = { 75000000, 150000000, 300000000, 600000000 };
+
+    double m_bit_error_rate = 0;
+    uint32_t m_corrupted_writes = 0;
+    uint32_t m_random = 12345;
+
+    uint32_t m_conversions = 0;
+    uint32_t m_eeprom_writes = 0;
+    uint32_t m_scratchpad_reads = 0;
+
+    void finish_operation(uint64_t now_ns);
+    void queue_bytes(const uint8_t* data, size_t length);
+    void on_byte(uint8_t byte, uint64_t now_ns);
+    bool next_random_error();
+
+public:
+    SimulatedDevice(BusSimulator& bus, uint64_t serial_number, bool parasite);
+
+    /**
+     * @return The Rom of the device, encoded like Rom::encode_rom (family code in the LSB).
+     */
+    uint64_t get_rom() const;
+
+    /**
+     * Sets the temperature the next conversions measure.
+     */
+    void set_temperature(float temperature);
+
+    /**
+     * Sets the raw value the next conversions measure, in 1/16 degree steps.
+     */
+    void set_raw_temperature(int16_t temperature);
+
+    /**
+     * Connects or disconnects the device from the bus. A disconnected device ignores the bus.
+     */
+    void set_connected(bool connected);
+
+    /**
+     * Makes the device accept Overdrive Skip ROM and Overdrive Match ROM (which the ds18b20 does not).
+     */
+    void set_overdrive_capable(bool capable);
+
+    /**
+     * Sets the probability of each bit sent by the device being flipped (e.g. by noise on the bus).
+     */
+    void set_bit_error_rate(double rate);
+
+    /**
+     * Makes the next Write Scratchpad commands store a wrong TH (with its lowest bit flipped), as if a written bit
+     * had been misread. The scratchpad stays consistent with its CRC code.
+     * @param count The number of writes to corrupt.
+     */
+    void set_corrupted_scratchpad_writes(uint32_t count);
+
+    /**
+     * Sets the conversion time of a resolution (0 for 9-bit to 3 for 12-bit).
+     */
+    void set_conversion_time_us(int resolution, uint32_t time_us);
+
+    /**
+     * Sets the content of the EEPROM and copies it to the scratchpad, as done at power-up.
+     */
+    void set_eeprom(int8_t temperature_high, int8_t temperature_low, uint8_t configuration);
+
+    int8_t get_eeprom_temperature_high() const;
+    int8_t get_eeprom_temperature_low() const;
+    uint8_t get_eeprom_configuration() const;
+    uint8_t get_scratchpad_configuration() const;
+    bool is_overdrive() const;
+    bool is_parasite() const;
+    uint32_t get_conversions() const;
+    uint32_t get_eeprom_writes() const;
+    uint32_t get_scratchpad_reads() const;
+
+    // Bus interface
+    bool is_driving_low() const;
+    bool on_reset(uint64_t now_ns, uint64_t low_ns);
+    void on_slot_start(uint64_t now_ns);
+    void on_sample(uint64_t now_ns, bool level);
+    void on_release(uint32_t generation);
+    void on_presence(uint32_t generation, bool start);
+    void on_master_change(uint64_t now_ns, bool strong_high);
+    void update(uint64_t now_ns);
+};
+
+/**
+ * A simulated 1-Wire bus: a wired-AND line with a pull-up resistor, driven by the master (through the GPIO functions
+ * of the fake Hal or the PIO emulator) and by SimulatedDevice objects. It records the resets and time slots of the
+ * master, checks them against the timing limits of the 1-Wire protocol and decodes the bytes written by the master.
+ */
+class BusSimulator {
+public:
+    /// The events of the devices, processed in time order by the simulation
+    enum class EventType {
+        Sample, ///< The device samples the bus
+        Release, ///< The device stops holding the bus low after sending a 0
+        PresenceStart, ///< The device starts the presence pulse
+        PresenceEnd ///< The device ends the presence pulse
+    };
+
+private:
+    struct Event {
+        uint64_t time_ns;
+        uint64_t order;
+        SimulatedDevice* device;
+        EventType type;
+        uint32_t generation;
+
+        bool operator>(const Event& other) const {
+            return time_ns != other.time_ns ? time_ns > other.time_ns : order > other.order;
+        }
+    };
+
+    int m_pin;
+    std::vector<std::unique_ptr<SimulatedDevice>> m_devices;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+    uint64_t m_event_order = 0;
+
+    // The state of the master
+    bool m_pio_function = false;
+    bool m_pio_output = false;
+    bool m_sio_output = false;
+    bool m_sio_value = false;
+    bool m_master_low = false;
+    bool m_strong_high = false;
+
+    bool m_overdrive = false;
+    bool m_started = false;
+    bool m_in_slot = false;
+    bool m_slot_is_reset = false;
+    uint64_t m_fall_ns = 0;
+    uint64_t m_rise_ns = 0;
+    uint64_t m_low_ns = 0;
+    bool m_sampled = false;
+
+    bool m_recording = false;
+    std::vector<SlotRecord> m_records;
+    std::vector<std::vector<uint8_t>> m_frames;
+    uint8_t m_frame_byte = 0;
+    int m_frame_bits = 0;
+
+    uint32_t m_resets = 0;
+    uint32_t m_slots = 0;
+    uint32_t m_timing_violations = 0;
+
+    void update_master();
+    void on_fall(uint64_t now_ns);
+    void on_rise(uint64_t now_ns);
+
+public:
+    /**
+     * Creates a bus on the given GPIO and attaches it to the simulation.
+     */
+    explicit BusSimulator(int pin);
+    ~BusSimulator();
+
+    BusSimulator(const BusSimulator&) = delete;
+    BusSimulator& operator=(const BusSimulator&) = delete;
+
+    /**
+     * Connects a new device to the bus.
+     * @param serial_number The 48-bit serial number of its Rom (the family code is 0x28).
+     * @param parasite True if the device is in parasite power mode.
+     */
+    SimulatedDevice& add_device(uint64_t serial_number, bool parasite = false);
+
+    /**
+     * @return The index-th device connected to the bus.
+     */
+    SimulatedDevice& get_device(size_t index);
+
+    /**
+     * @return The number of devices connected to the bus.
+     */
+    size_t get_device_count() const;
+
+    /**
+     * Starts or stops recording the slots and the bytes written by the master (see get_records and get_frames).
+     */
+    void set_recording(bool recording);
+
+    /**
+     * @return The resets and time slots recorded since the last clear_records() call.
+     */
+    const std::vector<SlotRecord>& get_records() const;
+
+    /**
+     * @return The bytes written by the master since the last clear_records() call, one frame per reset. The read
+     * slots are write 1 slots, so the bytes read show up as 0xFF.
+     */
+    const std::vector<std::vector<uint8_t>>& get_frames() const;
+
+    /**
+     * Clears the records, the frames and the counters.
+     */
+    void clear_records();
+
+    /**
+     * @return The number of resets issued by the master.
+     */
+    uint32_t get_resets() const;
+
+    /**
+     * @return The number of time slots issued by the master.
+     */
+    uint32_t get_slots() const;
+
+    /**
+     * @return The number of resets and time slots outside of the limits of the 1-Wire protocol.
+     */
+    uint32_t get_timing_violations() const;
+
+    /**
+     * @return The current level of the bus (true if high), as sampled by the master.
+     */
+    bool read();
+
+    /**
+     * @return The current level of the bus (true if high).
+     */
+    bool get_level() const;
+
+    /**
+     * @return True if the master drives the bus high (strong pull-up).
+     */
+    bool is_strong_high() const;
+
+    /**
+     * @return True if the devices were switched to overdrive speed.
+     */
+    bool is_overdrive() const;
+
+    // Master interface (fake Hal and PIO emulator)
+    int get_pin() const;
+    void set_sio_direction(bool output);
+    void set_sio_value(bool value);
+    void set_pio_function(bool enabled);
+    void set_pio_output(bool output);
+
+    // Device and simulation interface
+    void schedule(uint64_t time_ns, SimulatedDevice* device, EventType type, uint32_t generation = 0);
+    void set_overdrive(bool overdrive);
+    uint64_t get_next_event_ns() const;
+    void process_event();
+};
@@ -0,0 +1,119 @@
+#include "hal.hpp"
+
+#include <cstring>
+#include <thread>
+
+#include "bus_simulator.hpp"
+#include "simulation.hpp"
+
+// The Hal of the host tests: the GPIOs are connected to simulated buses and the time is simulated (see Simulation).
+// The slot engine functions come from src/hal_pio.cpp, running on the PIO emulator.
+
+namespace {
+
+/// The GPIOs that are not connected to a bus (e.g. the strong pull-up pin)
+bool pin_values[32];
+
+std::thread core1;
+
+uint64_t sleep_time_us = 0; ///< See Hal::get_sleep_time_us()
+
+}
+
+void Hal::init_pin(int pin) {
+    set_pin_direction(pin, false);
+    set_pin_value(pin, false);
+}
+
+void Hal::set_pin_direction(int pin, bool output) {
+    BusSimulator* bus = Simulation::get_bus(pin);
+    if (bus != nullptr) {
+        bus->set_sio_direction(output);
+    }
+}
+
+void Hal::set_pin_value(int pin, bool value) {
+    pin_values[pin] = value;
+    BusSimulator* bus = Simulation::get_bus(pin);
+    if (bus != nullptr) {
+        bus->set_sio_value(value);
+    }
+}
+
+bool Hal::get_pin_value(int pin) {
+    BusSimulator* bus = Simulation::get_bus(pin);
+    if (bus == nullptr) {
+        return pin_values[pin];
+    }
+
+    return bus->read();
+}
+
+void Hal::sleep_us(uint32_t time_us) {
+    sleep_time_us += time_us;
+    Simulation::advance(time_us * 1000ull, false);
+}
+
+void Hal::busy_wait_cycles(uint32_t cycles) {
+    Simulation::advance(cycles * 1000ull / m_cycles_per_us, true);
+}
+
+uint32_t Hal::disable_interrupts() {
+    return Simulation::disable_interrupts();
+}
+
+void Hal::restore_interrupts(uint32_t state) {
+    Simulation::restore_interrupts(state);
+}
+
+void Hal::sleep_ms(uint32_t time_ms) {
+    sleep_time_us += time_ms * 1000ull;
+    Simulation::advance(time_ms * 1000000ull, false);
+}
+
+void Hal::launch_core1(void (*entry)()) {
+    // The simulation is not thread safe, the entry must not use the Hal
+    if (core1.joinable()) {
+        core1.join();
+    }
+    core1 = std::thread(entry);
+}
+
+size_t Hal::get_storage_size() {
+    return Simulation::get_storage().size();
+}
+
+bool Hal::read_storage(uint8_t* data, size_t length) {
+    if (length > get_storage_size()) {
+        return false;
+    }
+
+    memcpy(data, Simulation::get_storage().data(), length);
+    return true;
+}
+
+bool Hal::write_storage(const uint8_t* data, size_t length) {
+    if (length > get_storage_size()) {
+        return false;
+    }
+
+    // Like the flash, the whole storage is erased first
+    std::string& storage = Simulation::get_storage();
+    storage.assign(storage.size(), '\xFF');
+    memcpy(&storage[0], data, length);
+    Simulation::save_storage();
+
+    return true;
+}
+
+uint64_t Hal::get_sleep_time_us() {
+    return sleep_time_us;
+}
+
+uint64_t Hal::get_time_us() {
+    return Simulation::get_time_ns() / 1000;
+}
+
+uint32_t Hal::get_time_ms() {
+    return Simulation::get_time_ns() / 1000000;
+}
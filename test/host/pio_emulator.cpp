@@ -0,0 +1,829 @@
+#include "pio_emulator.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "one_wire.pio.h"
+
+#include "bus_simulator.hpp"
+#include "simulation.hpp"
+
+pio_hw_t pio0_hw;
+pio_hw_t pio1_hw;
+
+const pio_program_t one_wire_program = { "one_wire" };
+
+namespace {
+
+const uint64_t system_clock_period_ns = 8; ///< 125 MHz
+const uint64_t cpu_poll_ns = 100; ///< The time of one iteration of a CPU loop polling a FIFO or a DMA channel
+const int instruction_memory_size = 32;
+const int fifo_depth = 4;
+const int dma_channel_count = 12;
+
+enum class Opcode { Jmp, Out, In, Push, Pull, Mov, Set };
+
+/// The operands of the instructions (sources, destinations and jump conditions)
+enum class Operand { None, X, Y, Null, Pins, Pindirs, Isr, Osr, Always, NotX, XDec, NotY, YDec };
+
+struct Instruction {
+    Opcode opcode;
+    Operand operand; ///< The destination, the source (in) or the condition (jmp)
+    Operand source; ///< The source of mov
+    uint32_t value; ///< The bit count, the value of set or the target of jmp (relative to the program)
+    int side;
+    int delay;
+};
+
+struct Program {
+    std::vector<Instruction> instructions;
+    std::map<std::string, uint> labels;
+    uint wrap_target = 0;
+    uint wrap = 0;
+};
+
+struct StateMachine {
+    bool claimed = false;
+    bool enabled = false;
+    uint64_t period_ns = 1000;
+    uint64_t next_cycle_ns = UINT64_MAX;
+    uint pc = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t osr = 0;
+    uint osr_count = 32;
+    uint32_t isr = 0;
+    uint isr_count = 0;
+    int delay = 0;
+    bool tx_stalled = false; ///< Stalled on an OUT with autopull or a PULL, because the TX FIFO is empty
+    bool has_exec = false;
+    uint exec_target = 0;
+    std::deque<uint32_t> tx_fifo;
+    std::deque<uint32_t> rx_fifo;
+    pio_sm_config config{};
+};
+
+struct Pio {
+    pio_hw_t* hw;
+    const Program* memory[instruction_memory_size] = {};
+    uint program_offset[instruction_memory_size] = {};
+    StateMachine sms[4];
+};
+
+struct DmaChannel {
+    bool claimed = false;
+    bool busy = false;
+    dma_channel_config config{};
+    volatile uint8_t* write_addr = nullptr;
+    const volatile uint8_t* read_addr = nullptr;
+    uint count = 0;
+};
+
+Pio pios[2] = { { &pio0_hw }, { &pio1_hw } };
+DmaChannel dma_channels[dma_channel_count];
+
+Pio& get_pio(PIO pio) {
+    return pios[pio == pio0 ? 0 : 1];
+}
+
+Operand parse_operand(const std::string& text) {
+    static const std::map<std::string, Operand> operands = {
+        { "x", Operand::X }, { "y", Operand::Y }, { "null", Operand::Null }, { "pins", Operand::Pins },
+        { "pindirs", Operand::Pindirs }, { "isr", Operand::Isr }, { "osr", Operand::Osr }, { "!x", Operand::NotX },
+        { "x--", Operand::XDec }, { "!y", Operand::NotY }, { "y--", Operand::YDec }
+    };
+    auto operand = operands.find(text);
+    if (operand == operands.end()) {
+        fprintf(stderr, "pio_emulator: unsupported operand %s\n", text.c_str());
+        abort();
+    }
+
+    return operand->second;
+}
+
+/**
+ * Assembles the given program of the source file (only the instructions used by the 1-Wire program are supported).
+ */
+Program assemble(const char* name) {
+    std::ifstream file(DS18B20_PIO_SOURCE);
+    if (!file) {
+        fprintf(stderr, "pio_emulator: cannot open %s\n", DS18B20_PIO_SOURCE);
+        abort();
+    }
+
+    Program program;
+    std::vector<std::pair<size_t, std::string>> jumps;
+    bool in_program = false;
+    std::string line;
+    std::regex delay_pattern("\\[(\\d+)\\]");
+    std::regex side_pattern("\\bside\\s+(\\d+)");
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find(';'));
+        std::smatch match;
+        int delay = 0;
+        int side = 0;
+        if (std::regex_search(line, match, delay_pattern)) {
+            delay = std::stoi(match[1]);
+            line = match.prefix().str() + match.suffix().str();
+        }
+        if (std::regex_search(line, match, side_pattern)) {
+            side = std::stoi(match[1]);
+            line = match.prefix().str() + match.suffix().str();
+        }
+        for (char& c : line) {
+            if (c == ',') {
+                c = ' ';
+            }
+        }
+        std::istringstream stream(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (stream >> token) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        if (tokens[0] == ".program") {
+            in_program = tokens[1] == name;
+            continue;
+        }
+        if (!in_program) {
+            continue;
+        }
+        if (tokens[0] == "public") {
+            tokens.erase(tokens.begin());
+        }
+        uint index = program.instructions.size();
+        if (tokens[0] == ".wrap_target") {
+            program.wrap_target = index;
+            continue;
+        }
+        if (tokens[0] == ".wrap") {
+            program.wrap = index - 1;
+            continue;
+        }
+        if (tokens[0][0] == '.') {
+            continue;
+        }
+        if (tokens[0].back() == ':') {
+            program.labels[tokens[0].substr(0, tokens[0].size() - 1)] = index;
+            continue;
+        }
+
+        Instruction instruction = { Opcode::Mov, Operand::Y, Operand::Y, 0, side, delay };
+        const std::string& mnemonic = tokens[0];
+        if (mnemonic == "jmp") {
+            instruction.opcode = Opcode::Jmp;
+            instruction.operand = tokens.size() == 3 ? parse_operand(tokens[1]) : Operand::Always;
+            jumps.push_back({ index, tokens.back() });
+        } else if (mnemonic == "out" || mnemonic == "in" || mnemonic == "set") {
+            instruction.opcode = mnemonic == "out" ? Opcode::Out : (mnemonic == "in" ? Opcode::In : Opcode::Set);
+            instruction.operand = parse_operand(tokens[1]);
+            instruction.value = std::stoul(tokens[2]);
+        } else if (mnemonic == "mov") {
+            instruction.operand = parse_operand(tokens[1]);
+            instruction.source = parse_operand(tokens[2]);
+        } else if (mnemonic == "push" || mnemonic == "pull") {
+            instruction.opcode = mnemonic == "push" ? Opcode::Push : Opcode::Pull;
+        } else if (mnemonic != "nop") {
+            fprintf(stderr, "pio_emulator: unsupported instruction %s\n", mnemonic.c_str());
+            abort();
+        }
+        program.instructions.push_back(instruction);
+    }
+    for (const std::pair<size_t, std::string>& jump : jumps) {
+        program.instructions[jump.first].value = program.labels.at(jump.second);
+    }
+    if (program.instructions.empty()) {
+        fprintf(stderr, "pio_emulator: program %s not found\n", name);
+        abort();
+    }
+    if (program.wrap == 0) {
+        program.wrap = program.instructions.size() - 1;
+    }
+
+    return program;
+}
+
+const Program& get_program(const pio_program_t* program) {
+    static std::map<std::string, Program> programs;
+    auto assembled = programs.find(program->name);
+    if (assembled == programs.end()) {
+        assembled = programs.emplace(program->name, assemble(program->name)).first;
+    }
+
+    return assembled->second;
+}
+
+BusSimulator* get_bus(uint pin) {
+    return Simulation::get_bus(pin);
+}
+
+bool read_pin(uint pin) {
+    BusSimulator* bus = get_bus(pin);
+    return bus == nullptr || bus->read();
+}
+
+void set_pindir(uint pin, bool output) {
+    BusSimulator* bus = get_bus(pin);
+    if (bus != nullptr) {
+        bus->set_pio_output(output);
+    }
+}
+
+uint get_threshold(uint32_t shiftctrl, uint32_t lsb) {
+    uint threshold = (shiftctrl >> lsb) & 0x1F;
+    return threshold == 0 ? 32 : threshold;
+}
+
+void wake(StateMachine& sm) {
+    if (sm.enabled && sm.next_cycle_ns == UINT64_MAX) {
+        sm.next_cycle_ns = Simulation::get_time_ns() + sm.period_ns;
+    }
+}
+
+/**
+ * Stalls a state machine on its empty TX FIFO, and sets its TXSTALL flag.
+ * @return False.
+ */
+bool stall_on_tx(Pio& pio, int index) {
+    pio.sms[index].tx_stalled = true;
+    pio.hw->fdebug.value |= 1u << (PIO_FDEBUG_TXSTALL_LSB + index);
+    return false;
+}
+
+/**
+ * Runs one cycle of a state machine.
+ * @return False if the state machine is stalled and nothing but the CPU or the DMA can resume it.
+ */
+bool step(Pio& pio, int index) {
+    StateMachine& sm = pio.sms[index];
+    uint32_t shiftctrl = pio.hw->sm[index].shiftctrl;
+    const Program& program = *pio.memory[sm.pc];
+    uint offset = pio.program_offset[sm.pc];
+
+    if (sm.has_exec) {
+        // Only unconditional jumps are executed by hal_pio.cpp. The side-set bit of the encoded jump is 0.
+        sm.has_exec = false;
+        sm.tx_stalled = false;
+        sm.pc = sm.exec_target;
+        sm.delay = 0;
+        set_pindir(sm.config.sideset_base, false);
+        return true;
+    }
+    if (sm.delay > 0) {
+        sm.delay--;
+        return true;
+    }
+
+    const Instruction& instruction = program.instructions[sm.pc - offset];
+    set_pindir(sm.config.sideset_base, instruction.side);
+    sm.tx_stalled = false;
+
+    bool jump = false;
+    uint32_t* destination = nullptr;
+    switch (instruction.opcode) {
+        case Opcode::Jmp:
+            switch (instruction.operand) {
+                case Operand::Always: jump = true; break;
+                case Operand::NotX: jump = sm.x == 0; break;
+                case Operand::XDec: jump = sm.x != 0; sm.x--; break;
+                case Operand::NotY: jump = sm.y == 0; break;
+                case Operand::YDec: jump = sm.y != 0; sm.y--; break;
+                default: abort();
+            }
+            break;
+        case Opcode::Out: {
+            // Autopull refills the OSR only once it has shifted out the threshold number of bits
+            bool autopull = shiftctrl & PIO_SM0_SHIFTCTRL_AUTOPULL_BITS;
+            if (autopull && sm.osr_count >= get_threshold(shiftctrl, PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB)) {
+                if (sm.tx_fifo.empty()) {
+                    return stall_on_tx(pio, index);
+                }
+                sm.osr = sm.tx_fifo.front();
+                sm.tx_fifo.pop_front();
+                sm.osr_count = 0;
+            }
+            uint bits = instruction.value;
+            uint32_t data = bits == 32 ? sm.osr : sm.osr & ((1u << bits) - 1);
+            sm.osr = bits == 32 ? 0 : sm.osr >> bits;
+            sm.osr_count = std::min(32u, sm.osr_count + bits);
+            if (instruction.operand == Operand::X) {
+                sm.x = data;
+            } else if (instruction.operand == Operand::Y) {
+                sm.y = data;
+            }
+            break;
+        }
+        case Opcode::In: {
+            bool autopush = shiftctrl & PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS;
+            uint threshold = get_threshold(shiftctrl, PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB);
+            uint bits = instruction.value;
+            if (autopush && sm.isr_count + bits >= threshold && (int)sm.rx_fifo.size() >= fifo_depth) {
+                return false;
+            }
+            uint32_t data = 0;
+            switch (instruction.operand) {
+                case Operand::Pins: data = read_pin(sm.config.in_base); break;
+                case Operand::X: data = sm.x; break;
+                case Operand::Y: data = sm.y; break;
+                default: break;
+            }
+            data &= bits == 32 ? 0xFFFFFFFF : ((1u << bits) - 1);
+            sm.isr = bits == 32 ? data : (sm.isr >> bits) | (data << (32 - bits));
+            sm.isr_count = std::min(32u, sm.isr_count + bits);
+            if (autopush && sm.isr_count >= threshold) {
+                sm.rx_fifo.push_back(sm.isr);
+                sm.isr = 0;
+                sm.isr_count = 0;
+            }
+            break;
+        }
+        case Opcode::Push:
+            if ((int)sm.rx_fifo.size() >= fifo_depth) {
+                return false;
+            }
+            sm.rx_fifo.push_back(sm.isr);
+            sm.isr = 0;
+            sm.isr_count = 0;
+            break;
+        case Opcode::Pull:
+            if (sm.tx_fifo.empty()) {
+                return stall_on_tx(pio, index);
+            }
+            sm.osr = sm.tx_fifo.front();
+            sm.tx_fifo.pop_front();
+            sm.osr_count = 0;
+            break;
+        case Opcode::Mov: {
+            uint32_t data = 0;
+            switch (instruction.source) {
+                case Operand::Pins: data = read_pin(sm.config.in_base); break;
+                case Operand::X: data = sm.x; break;
+                case Operand::Y: data = sm.y; break;
+                case Operand::Isr: data = sm.isr; break;
+                case Operand::Osr: data = sm.osr; break;
+                default: break;
+            }
+            switch (instruction.operand) {
+                case Operand::X: destination = &sm.x; break;
+                case Operand::Y: destination = &sm.y; break;
+                case Operand::Isr: destination = &sm.isr; sm.isr_count = 0; break;
+                case Operand::Osr: destination = &sm.osr; sm.osr_count = 0; break;
+                default: break;
+            }
+            if (destination != nullptr) {
+                *destination = data;
+            }
+            break;
+        }
+        case Opcode::Set:
+            if (instruction.operand == Operand::X) {
+                sm.x = instruction.value;
+            } else if (instruction.operand == Operand::Y) {
+                sm.y = instruction.value;
+            }
+            break;
+    }
+
+    if (jump) {
+        sm.pc = offset + instruction.value;
+    } else if (sm.pc == sm.config.wrap) {
+        sm.pc = sm.config.wrap_target;
+    } else {
+        sm.pc++;
+    }
+    sm.delay = instruction.delay;
+
+    return true;
+}
+
+bool is_dreq_ready(uint dreq) {
+    // DREQ_PIOx_TXy is pio * 8 + y, DREQ_PIOx_RXy is pio * 8 + 4 + y
+    StateMachine& sm = pios[dreq / 8].sms[dreq % 4];
+    if ((dreq % 8) < 4) {
+        return (int)sm.tx_fifo.size() < fifo_depth;
+    }
+
+    return !sm.rx_fifo.empty();
+}
+
+/**
+ * @return The state machine whose TX (or RX) FIFO register is at the given address, nullptr if none.
+ */
+StateMachine* find_fifo(const volatile void* address, bool tx, uint* byte) {
+    for (Pio& pio : pios) {
+        for (int i = 0; i < 4; i++) {
+            const volatile uint8_t* fifo = (const volatile uint8_t*)(tx ? &pio.hw->txf[i] : &pio.hw->rxf[i]);
+            const volatile uint8_t* data = (const volatile uint8_t*)address;
+            if (data >= fifo && data < fifo + 4) {
+                *byte = data - fifo;
+                return &pio.sms[i];
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void service_dma() {
+    for (DmaChannel& channel : dma_channels) {
+        while (channel.busy && is_dreq_ready(channel.config.dreq)) {
+            // Read a byte from memory or from the most significant bytes of an RX FIFO entry
+            uint byte_index;
+            uint8_t data;
+            StateMachine* rx = find_fifo(channel.read_addr, false, &byte_index);
+            if (rx != nullptr) {
+                data = rx->rx_fifo.front() >> (8 * byte_index);
+                rx->rx_fifo.pop_front();
+                wake(*rx);
+            } else {
+                data = *channel.read_addr;
+            }
+
+            // Byte writes to a FIFO register are replicated on the 4 byte lanes
+            StateMachine* tx = find_fifo(channel.write_addr, true, &byte_index);
+            if (tx != nullptr) {
+                tx->tx_fifo.push_back(data * 0x01010101u);
+                wake(*tx);
+            } else {
+                *channel.write_addr = data;
+            }
+
+            if (channel.config.read_increment) {
+                channel.read_addr++;
+            }
+            if (channel.config.write_increment) {
+                channel.write_addr++;
+            }
+            channel.busy = --channel.count > 0;
+        }
+    }
+}
+
+void apply_clkdiv(StateMachine& sm, float div) {
+    sm.period_ns = (uint64_t)(div * system_clock_period_ns + 0.5f);
+}
+
+void restart(StateMachine& sm) {
+    sm.osr_count = 32;
+    sm.isr = 0;
+    sm.isr_count = 0;
+    sm.delay = 0;
+    sm.tx_stalled = false;
+}
+
+}
+
+void PioEmulator::reset() {
+    for (Pio& pio : pios) {
+        *pio.hw = pio_hw_t();
+        for (int i = 0; i < instruction_memory_size; i++) {
+            pio.memory[i] = nullptr;
+        }
+        for (StateMachine& sm : pio.sms) {
+            sm = StateMachine();
+        }
+    }
+    for (DmaChannel& channel : dma_channels) {
+        channel = DmaChannel();
+    }
+}
+
+uint64_t PioEmulator::get_next_event_ns() {
+    uint64_t next_ns = UINT64_MAX;
+    for (Pio& pio : pios) {
+        for (StateMachine& sm : pio.sms) {
+            if (sm.enabled && sm.next_cycle_ns < next_ns) {
+                next_ns = sm.next_cycle_ns;
+            }
+        }
+    }
+
+    return next_ns;
+}
+
+void PioEmulator::process_event() {
+    uint64_t next_ns = get_next_event_ns();
+    for (Pio& pio : pios) {
+        for (int i = 0; i < 4; i++) {
+            StateMachine& sm = pio.sms[i];
+            if (!sm.enabled || sm.next_cycle_ns != next_ns) {
+                continue;
+            }
+            if (step(pio, i) || sm.delay > 0) {
+                sm.next_cycle_ns += sm.period_ns;
+            } else {
+                sm.next_cycle_ns = UINT64_MAX;
+            }
+            service_dma();
+            return;
+        }
+    }
+}
+
+int PioEmulator::get_free_instructions(int pio) {
+    int free = 0;
+    for (int i = 0; i < instruction_memory_size; i++) {
+        free += pios[pio].memory[i] == nullptr;
+    }
+
+    return free;
+}
+
+void PioEmulator::claim_all_dma_channels() {
+    for (DmaChannel& channel : dma_channels) {
+        channel.claimed = true;
+    }
+}
+
+void tight_loop_contents() {
+    Simulation::advance(cpu_poll_ns, true);
+
+    // The TXSTALL flag is set again in every cycle the state machine is stalled, even after it was cleared
+    for (Pio& pio : pios) {
+        for (int i = 0; i < 4; i++) {
+            if (pio.sms[i].enabled && pio.sms[i].tx_stalled) {
+                pio.hw->fdebug.value |= 1u << (PIO_FDEBUG_TXSTALL_LSB + i);
+            }
+        }
+    }
+}
+
+uint pio_emulator_get_label(const pio_program_t* program, const char* label) {
+    return get_program(program).labels.at(label);
+}
+
+pio_sm_config one_wire_program_get_default_config(uint offset) {
+    const Program& program = get_program(&one_wire_program);
+    pio_sm_config config = pio_get_default_sm_config();
+    sm_config_set_wrap(&config, offset + program.wrap_target, offset + program.wrap);
+    return config;
+}
+
+pio_sm_config pio_get_default_sm_config() {
+    pio_sm_config config{};
+    config.clkdiv = 1;
+    config.shiftctrl = PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_BITS | PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_BITS;
+    config.wrap = instruction_memory_size - 1;
+    return config;
+}
+
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base) {
+    c->in_base = in_base;
+}
+
+void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base) {
+    c->sideset_base = sideset_base;
+}
+
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold) {
+    if (!shift_right) {
+        fprintf(stderr, "pio_emulator: only right shifts are supported\n");
+        abort();
+    }
+    c->shiftctrl = (c->shiftctrl & ~(PIO_SM0_SHIFTCTRL_AUTOPULL_BITS | PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS)) |
+        (autopull ? PIO_SM0_SHIFTCTRL_AUTOPULL_BITS : 0) | ((pull_threshold & 0x1F) << PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB);
+}
+
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold) {
+    if (!shift_right) {
+        fprintf(stderr, "pio_emulator: only right shifts are supported\n");
+        abort();
+    }
+    c->shiftctrl = (c->shiftctrl & ~(PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS | PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS)) |
+        (autopush ? PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS : 0) | ((push_threshold & 0x1F) << PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB);
+}
+
+void sm_config_set_clkdiv(pio_sm_config* c, float div) {
+    c->clkdiv = div;
+}
+
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap) {
+    c->wrap_target = wrap_target;
+    c->wrap = wrap;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program) {
+    return PioEmulator::get_free_instructions(pio == pio0 ? 0 : 1) >= (int)get_program(program).instructions.size();
+}
+
+uint pio_add_program(PIO pio, const pio_program_t* program) {
+    // Programs are loaded at the first free offset
+    Pio& p = get_pio(pio);
+    const Program& assembled = get_program(program);
+    uint length = assembled.instructions.size();
+    for (uint offset = 0; offset + length <= instruction_memory_size; offset++) {
+        bool free = true;
+        for (uint i = 0; i < length; i++) {
+            free = free && p.memory[offset + i] == nullptr;
+        }
+        if (!free) {
+            continue;
+        }
+        for (uint i = 0; i < length; i++) {
+            p.memory[offset + i] = &assembled;
+            p.program_offset[offset + i] = offset;
+        }
+        return offset;
+    }
+
+    fprintf(stderr, "pio_emulator: no space for program %s\n", program->name);
+    abort();
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    Pio& p = get_pio(pio);
+    for (int i = 0; i < 4; i++) {
+        if (!p.sms[i].claimed) {
+            p.sms[i].claimed = true;
+            return i;
+        }
+    }
+    if (required) {
+        abort();
+    }
+
+    return -1;
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    (void)pio;
+    BusSimulator* bus = get_bus(pin);
+    if (bus != nullptr) {
+        bus->set_pio_function(true);
+    }
+}
+
+void gpio_pull_up(unsigned int gpio) {
+    (void)gpio;
+}
+
+void gpio_set_function(unsigned int gpio, enum gpio_function function) {
+    BusSimulator* bus = get_bus(gpio);
+    if (bus != nullptr) {
+        bus->set_pio_function(function != GPIO_FUNC_SIO);
+    }
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) {
+    // The output values of the 1-Wire program are always 0
+    (void)pio;
+    (void)sm;
+    (void)pin_values;
+    (void)pin_mask;
+}
+
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask) {
+    (void)pio;
+    (void)sm;
+    for (uint pin = 0; pin < 32; pin++) {
+        if (pin_mask & (1u << pin)) {
+            set_pindir(pin, pin_dirs & (1u << pin));
+        }
+    }
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config) {
+    Pio& p = get_pio(pio);
+    StateMachine& s = p.sms[sm];
+    s.enabled = false;
+    s.next_cycle_ns = UINT64_MAX;
+    s.config = *config;
+    p.hw->sm[sm].shiftctrl = config->shiftctrl;
+    apply_clkdiv(s, config->clkdiv);
+    s.tx_fifo.clear();
+    s.rx_fifo.clear();
+    restart(s);
+    s.has_exec = false;
+    s.pc = initial_pc;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    StateMachine& s = get_pio(pio).sms[sm];
+    s.enabled = enabled;
+    s.next_cycle_ns = UINT64_MAX;
+    wake(s);
+}
+
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div) {
+    apply_clkdiv(get_pio(pio).sms[sm], div);
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+    StateMachine& s = get_pio(pio).sms[sm];
+    restart(s);
+    wake(s);
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    if ((instr & 0xE000) != 0 || (instr & 0x1FE0) != 0) {
+        fprintf(stderr, "pio_emulator: only unconditional jumps can be executed\n");
+        abort();
+    }
+    StateMachine& s = get_pio(pio).sms[sm];
+    s.has_exec = true;
+    s.exec_target = instr & 0x1F;
+    wake(s);
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+    StateMachine& s = get_pio(pio).sms[sm];
+    while ((int)s.tx_fifo.size() >= fifo_depth) {
+        Simulation::advance(cpu_poll_ns, true);
+    }
+    s.tx_fifo.push_back(data);
+    wake(s);
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
+    StateMachine& s = get_pio(pio).sms[sm];
+    while (s.rx_fifo.empty()) {
+        Simulation::advance(cpu_poll_ns, true);
+    }
+    uint32_t data = s.rx_fifo.front();
+    s.rx_fifo.pop_front();
+    wake(s);
+
+    return data;
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    return (pio == pio0 ? 0 : 8) + (is_tx ? 0 : 4) + sm;
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (int i = 0; i < dma_channel_count; i++) {
+        if (!dma_channels[i].claimed) {
+            dma_channels[i].claimed = true;
+            return i;
+        }
+    }
+    if (required) {
+        abort();
+    }
+
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    dma_channels[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config config{};
+    config.read_increment = true;
+    config.write_increment = false;
+    config.size = DMA_SIZE_32;
+    return config;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {
+    if (size != DMA_SIZE_8) {
+        fprintf(stderr, "pio_emulator: only byte transfers are supported\n");
+        abort();
+    }
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config* c, bool increment) {
+    c->read_increment = increment;
+}
+
+void channel_config_set_write_increment(dma_channel_config* c, bool increment) {
+    c->write_increment = increment;
+}
+
+void channel_config_set_dreq(dma_channel_config* c, uint dreq) {
+    c->dreq = dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr, const volatile void* read_addr,
+        uint transfer_count, bool trigger) {
+    DmaChannel& c = dma_channels[channel];
+    c.config = *config;
+    c.write_addr = (volatile uint8_t*)write_addr;
+    c.read_addr = (const volatile uint8_t*)read_addr;
+    c.count = transfer_count;
+    c.busy = trigger && transfer_count > 0;
+    service_dma();
+}
+
+bool dma_channel_is_busy(uint channel) {
+    Simulation::advance(cpu_poll_ns, true);
+    return dma_channels[channel].busy;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * A cycle-accurate emulator of the RP2040 PIO blocks and DMA channels, for the subset of the SDK used by
+ * src/hal_pio.cpp (see test/host/sdk). The programs are assembled at run time from their source
+ * (DS18B20_PIO_SOURCE), so the host tests run the same program as the device. Each state machine is stepped one
+ * cycle at a time at the rate of its clock divider, sampling and driving the simulated bus of its pins, and
+ * sleeps while it is stalled on an empty TX FIFO.
+ */
+class PioEmulator {
+public:
+    /**
+     * Unloads all programs and releases all state machines and DMA channels.
+     */
+    static void reset();
+
+    /**
+     * @return The time of the next cycle of a running state machine, UINT64_MAX if none.
+     */
+    static uint64_t get_next_event_ns();
+
+    /**
+     * Runs the next cycle of the state machine returned by get_next_event_ns(), then services the DMA channels.
+     */
+    static void process_event();
+
+    /**
+     * @return The number of free instructions of the given PIO block (0 or 1).
+     */
+    static int get_free_instructions(int pio);
+
+    /**
+     * Claims all DMA channels, so the next slot engines have no block transfers.
+     */
+    static void claim_all_dma_channels();
+};
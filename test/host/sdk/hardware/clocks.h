@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+enum clock_index { clk_sys = 5 };
+
+/// The emulated system clock runs at the default 125 MHz
+static inline uint32_t clock_get_hz(enum clock_index) {
+    return 125000000;
+}
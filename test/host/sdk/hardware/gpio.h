@@ -0,0 +1,8 @@
+#pragma once
+
+// The subset of the GPIO API of the Pico SDK used by src/hal_pio.cpp, served by the PIO emulator (see pio_emulator.hpp)
+
+enum gpio_function { GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6, GPIO_FUNC_PIO1 = 7 };
+
+void gpio_pull_up(unsigned int gpio);
+void gpio_set_function(unsigned int gpio, enum gpio_function function);
@@ -0,0 +1,107 @@
+#pragma once
+
+// The subset of the PIO API of the Pico SDK used by src/hal_pio.cpp, served by the PIO emulator (see pio_emulator.hpp)
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+typedef volatile uint32_t io_rw_32;
+typedef volatile uint8_t io_rw_8;
+
+typedef struct {
+    io_rw_32 clkdiv;
+    io_rw_32 execctrl;
+    io_rw_32 shiftctrl;
+    io_rw_32 addr;
+    io_rw_32 instr;
+    io_rw_32 pinctrl;
+} pio_sm_hw_t;
+
+/// A register whose bits are cleared by writing 1 to them, like the flags of FDEBUG
+struct io_w1c_32 {
+    uint32_t value;
+
+    io_w1c_32& operator=(uint32_t bits) {
+        value &= ~bits;
+        return *this;
+    }
+
+    operator uint32_t() const {
+        return value;
+    }
+};
+
+typedef struct {
+    io_w1c_32 fdebug;
+    io_rw_32 txf[4];
+    io_rw_32 rxf[4];
+    pio_sm_hw_t sm[4];
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+extern pio_hw_t pio0_hw;
+extern pio_hw_t pio1_hw;
+
+#define pio0 (&pio0_hw)
+#define pio1 (&pio1_hw)
+
+#define PIO_FDEBUG_TXSTALL_LSB 24u
+
+#define PIO_SM0_SHIFTCTRL_AUTOPUSH_BITS 0x00010000u
+#define PIO_SM0_SHIFTCTRL_AUTOPULL_BITS 0x00020000u
+#define PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_BITS 0x00040000u
+#define PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_BITS 0x00080000u
+#define PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB 20u
+#define PIO_SM0_SHIFTCTRL_PUSH_THRESH_BITS 0x01f00000u
+#define PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB 25u
+#define PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS 0x3e000000u
+
+/// A program of the emulator, identified by its name in the source file
+typedef struct {
+    const char* name;
+} pio_program_t;
+
+typedef struct {
+    float clkdiv;
+    uint32_t shiftctrl;
+    uint wrap_target;
+    uint wrap;
+    uint in_base;
+    uint sideset_base;
+} pio_sm_config;
+
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base);
+void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base);
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_clkdiv(pio_sm_config* c, float div);
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap);
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program);
+uint pio_add_program(PIO pio, const pio_program_t* program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+
+/// Normally declared in pico/platform.h (included by hardware/pio.h). Lets the emulated time pass while the CPU spins.
+void tight_loop_contents(void);
+
+static inline uint pio_encode_jmp(uint addr) {
+    return addr;
+}
+
+static inline void hw_write_masked(io_rw_32* addr, uint32_t values, uint32_t write_mask) {
+    *addr = (*addr & ~write_mask) | (values & write_mask);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Replaces the header generated by pioasm: the PIO emulator runs src/one_wire.pio from its source
+
+#include "hardware/pio.h"
+
+extern const pio_program_t one_wire_program;
+
+uint pio_emulator_get_label(const pio_program_t* program, const char* label);
+
+#define one_wire_offset_reset pio_emulator_get_label(&one_wire_program, "reset")
+#define one_wire_offset_slot pio_emulator_get_label(&one_wire_program, "slot")
+
+pio_sm_config one_wire_program_get_default_config(uint offset);
@@ -0,0 +1,25 @@
+#pragma once
+
+// The subset of pico/stdlib.h used by the examples, served by the simulated platform (see simulation.hpp)
+
+#include <stdint.h>
+
+#include "hal.hpp"
+
+void tight_loop_contents(void);
+
+static inline void stdio_init_all() {
+}
+
+/// The output of the host executables is always connected
+static inline bool stdio_usb_connected() {
+    return true;
+}
+
+static inline uint64_t time_us_64() {
+    return Hal::get_time_us();
+}
+
+static inline void sleep_ms(uint32_t time_ms) {
+    Hal::sleep_ms(time_ms);
+}
@@ -0,0 +1,167 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "bus_simulator.hpp"
+#include "pio_emulator.hpp"
+
+namespace {
+
+const size_t storage_size = 4096; ///< The size of a flash sector
+
+uint64_t time_ns = 0;
+uint64_t cpu_busy_ns = 0;
+std::vector<BusSimulator*> buses;
+
+bool interrupts_enabled = true;
+uint64_t interrupt_period_ns = 0;
+uint64_t interrupt_duration_ns = 0;
+uint64_t next_interrupt_ns = 0;
+uint32_t interrupt_count = 0;
+
+std::string storage(storage_size, '\xFF');
+std::string storage_file;
+
+/**
+ * Processes the events of the buses and the PIO emulator up to the given time, in time order.
+ */
+void run_until(uint64_t end_ns) {
+    while (true) {
+        uint64_t next_ns = PioEmulator::get_next_event_ns();
+        BusSimulator* next_bus = nullptr;
+        for (BusSimulator* bus : buses) {
+            if (bus->get_next_event_ns() < next_ns) {
+                next_ns = bus->get_next_event_ns();
+                next_bus = bus;
+            }
+        }
+        if (next_ns > end_ns) {
+            break;
+        }
+
+        time_ns = std::max(time_ns, next_ns);
+        if (next_bus != nullptr) {
+            next_bus->process_event();
+        } else {
+            PioEmulator::process_event();
+        }
+    }
+    time_ns = std::max(time_ns, end_ns);
+}
+
+void run_interrupt() {
+    interrupt_count++;
+    next_interrupt_ns += interrupt_period_ns;
+    run_until(time_ns + interrupt_duration_ns);
+}
+
+}
+
+void Simulation::reset() {
+    time_ns = 0;
+    cpu_busy_ns = 0;
+    buses.clear();
+    interrupts_enabled = true;
+    interrupt_period_ns = 0;
+    interrupt_count = 0;
+    storage.assign(storage_size, '\xFF');
+    storage_file.clear();
+    PioEmulator::reset();
+}
+
+uint64_t Simulation::get_time_ns() {
+    return time_ns;
+}
+
+void Simulation::advance(uint64_t wait_ns, bool busy) {
+    uint64_t end_ns = time_ns + wait_ns;
+    if (busy) {
+        cpu_busy_ns += wait_ns;
+    }
+
+    while (interrupt_period_ns > 0 && interrupts_enabled && next_interrupt_ns <= end_ns) {
+        run_until(next_interrupt_ns);
+        run_interrupt();
+
+        // A busy wait counts cycles, so it is stretched by the interrupt. A sleep is not.
+        if (busy) {
+            end_ns += interrupt_duration_ns;
+        }
+    }
+    run_until(end_ns);
+}
+
+uint64_t Simulation::get_cpu_busy_ns() {
+    return cpu_busy_ns;
+}
+
+void Simulation::attach_bus(BusSimulator* bus) {
+    buses.push_back(bus);
+}
+
+void Simulation::detach_bus(BusSimulator* bus) {
+    buses.erase(std::remove(buses.begin(), buses.end(), bus), buses.end());
+}
+
+BusSimulator* Simulation::get_bus(int pin) {
+    for (BusSimulator* bus : buses) {
+        if (bus->get_pin() == pin) {
+            return bus;
+        }
+    }
+
+    return nullptr;
+}
+
+void Simulation::set_interrupts(uint32_t period_us, uint32_t duration_us) {
+    interrupt_period_ns = period_us * 1000ull;
+    interrupt_duration_ns = duration_us * 1000ull;
+    next_interrupt_ns = time_ns + interrupt_period_ns;
+}
+
+uint32_t Simulation::disable_interrupts() {
+    uint32_t state = interrupts_enabled;
+    interrupts_enabled = false;
+    return state;
+}
+
+void Simulation::restore_interrupts(uint32_t state) {
+    interrupts_enabled = state;
+
+    // Run the interrupts that fired in the meantime
+    while (interrupts_enabled && interrupt_period_ns > 0 && next_interrupt_ns <= time_ns) {
+        run_interrupt();
+    }
+}
+
+uint32_t Simulation::get_interrupt_count() {
+    return interrupt_count;
+}
+
+std::string& Simulation::get_storage() {
+    return storage;
+}
+
+void Simulation::set_storage_file(const std::string& path) {
+    storage_file = path;
+    storage.assign(storage_size, '\xFF');
+    if (path.empty()) {
+        return;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    storage.replace(0, std::min(content.size(), storage_size), content, 0, std::min(content.size(), storage_size));
+}
+
+void Simulation::save_storage() {
+    if (storage_file.empty()) {
+        return;
+    }
+
+    std::ofstream file(storage_file, std::ios::binary | std::ios::trunc);
+    file.write(storage.data(), storage.size());
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+class BusSimulator;
+
+/**
+ * The state of the simulated platform behind the fake Hal (test/host/hal.cpp): a virtual clock that only advances
+ * when the library waits, the simulated buses attached to the GPIOs, injected interrupts and the persistent storage.
+ * The PIO emulator and the buses are stepped in time order whenever the clock advances.
+ */
+class Simulation {
+public:
+    /**
+     * Restores the initial state: time 0, no buses, no interrupts, no PIO state machines or DMA channels claimed
+     * and an empty storage.
+     */
+    static void reset();
+
+    /**
+     * @return The simulated time since boot, in nanoseconds.
+     */
+    static uint64_t get_time_ns();
+
+    /**
+     * Advances the simulated time, processing the events of the buses and the PIO emulator on the way.
+     * @param time_ns The time to wait.
+     * @param busy True if the CPU spins while waiting (busy wait, polling), false if it sleeps.
+     */
+    static void advance(uint64_t time_ns, bool busy);
+
+    /**
+     * @return The time the CPU spent spinning (busy waits and polling), in nanoseconds.
+     */
+    static uint64_t get_cpu_busy_ns();
+
+    static void attach_bus(BusSimulator* bus);
+    static void detach_bus(BusSimulator* bus);
+
+    /**
+     * @return The bus attached to the GPIO, nullptr if none.
+     */
+    static BusSimulator* get_bus(int pin);
+
+    /**
+     * Fires an interrupt every period_us microseconds (starting one period from now), which takes the CPU away for
+     * duration_us microseconds. Interrupts that fire while interrupts are disabled run when they are restored.
+     * @param period_us The time between two interrupts, 0 to stop the interrupts.
+     */
+    static void set_interrupts(uint32_t period_us, uint32_t duration_us);
+
+    static uint32_t disable_interrupts();
+    static void restore_interrupts(uint32_t state);
+
+    /**
+     * @return The number of interrupts that ran so far.
+     */
+    static uint32_t get_interrupt_count();
+
+    /**
+     * @return The content of the persistent storage (erased bytes are 0xFF).
+     */
+    static std::string& get_storage();
+
+    /**
+     * Sets the file backing the persistent storage: it is loaded now and saved after every write. Empty for none.
+     */
+    static void set_storage_file(const std::string& path);
+
+    static void save_storage();
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "simulation.hpp"
+
+/**
+ * A minimal test runner for the host tests. Each TEST runs in its own process on a fresh simulation, so the static
+ * state of the library (e.g. the claimed slot engines of hal_pio.cpp) does not leak between tests.
+ */
+namespace test {
+
+struct TestCase {
+    const char* name;
+    void (*function)();
+};
+
+inline std::vector<TestCase>& get_tests() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+struct Registrar {
+    Registrar(const char* name, void (*function)()) {
+        get_tests().push_back({ name, function });
+    }
+};
+
+inline int failures = 0;
+
+/**
+ * Runs the tests whose name contains the first argument (all if none), and returns the exit code of the executable.
+ */
+inline int run(int argc, char** argv) {
+    int failed = 0;
+    for (const TestCase& test : get_tests()) {
+        if (argc > 1 && strstr(test.name, argv[1]) == nullptr) {
+            continue;
+        }
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            Simulation::reset();
+            test.function();
+            fflush(stdout);
+            _exit(failures == 0 ? 0 : 1);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        bool passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        printf("[%s] %s\n", passed ? "PASS" : "FAIL", test.name);
+        failed += !passed;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
+
+}
+
+#define TEST(name) \
+    static void name(); \
+    static test::Registrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            test::failures++; \
+        } \
+    } while (false)
+
+#define REQUIRE(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: REQUIRE(%s) failed\n", __FILE__, __LINE__, #condition); \
+            fflush(stdout); \
+            _exit(1); \
+        } \
+    } while (false)
+
+#define TEST_MAIN() \
+    int main(int argc, char** argv) { \
+        return test::run(argc, argv); \
+    }
@@ -0,0 +1,111 @@
+#include "test.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "bus_manager.hpp"
+#include "bus_simulator.hpp"
+#include "ds18b20_registry.hpp"
+#include "hal.hpp"
+#include "one_wire.hpp"
+
+namespace {
+
+const size_t devices_per_bus = 8;
+
+/**
+ * Measures buses of 8 devices each (on pins 0, 1, ...) with a BusManager, checks the temperatures and prints the
+ * time of the scratchpad reads, from the end of the last conversion.
+ * @return The time of the scratchpad reads in microseconds.
+ */
+uint64_t measure_buses(size_t bus_count, OneWireBackend backend) {
+    std::vector<std::unique_ptr<BusSimulator>> buses;
+    std::vector<std::unique_ptr<OneWire>> one_wires;
+    std::vector<std::unique_ptr<Ds18b20Registry<devices_per_bus>>> registries;
+    BusManager manager;
+    for (size_t b = 0; b < bus_count; b++) {
+        buses.emplace_back(new BusSimulator(b));
+        for (size_t i = 0; i < devices_per_bus; i++) {
+            buses[b]->add_device((b + 1) * 0x1000 + i).set_temperature(b + i * 0.5f);
+        }
+        one_wires.emplace_back(new OneWire(b, backend));
+        REQUIRE(one_wires[b]->get_backend() == backend);
+        registries.emplace_back(new Ds18b20Registry<devices_per_bus>());
+        REQUIRE(registries[b]->find_devices(*one_wires[b]) == devices_per_bus);
+        REQUIRE(manager.add_bus(*one_wires[b], *registries[b]));
+    }
+
+    REQUIRE(manager.measure_temperatures() == bus_count);
+    uint64_t end_time = Hal::get_time_us();
+    uint64_t conversion_end_time = 0;
+    for (size_t b = 0; b < bus_count; b++) {
+        CHECK(manager.is_measured(b));
+        if (manager.get_conversion_end_us(b) > conversion_end_time) {
+            conversion_end_time = manager.get_conversion_end_us(b);
+        }
+        for (size_t i = 0; i < devices_per_bus; i++) {
+            int index = registries[b]->index_of(buses[b]->get_device(i).get_rom());
+            REQUIRE(index >= 0);
+            CHECK(registries[b]->get_raw_temperature(index) == (int16_t)((b + i * 0.5f) * 16));
+        }
+        CHECK(buses[b]->get_timing_violations() == 0);
+    }
+
+    uint64_t read_time = end_time - conversion_end_time;
+    printf("%d buses of %d devices: %.1f ms of scratchpad reads, %.0f samples/s\n", (int)bus_count, (int)devices_per_bus,
+        read_time / 1000.0, bus_count * devices_per_bus * 1e6 / read_time);
+
+    return read_time;
+}
+
+/**
+ * Runs measure_buses() in a child process on a fresh simulation, as the slot engines claimed by the OneWire objects
+ * are never released.
+ * @return The time of the scratchpad reads in microseconds.
+ */
+uint64_t measure_buses_isolated(size_t bus_count, OneWireBackend backend) {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        Simulation::reset();
+        uint64_t read_time = measure_buses(bus_count, backend);
+        REQUIRE(write(fds[1], &read_time, sizeof(read_time)) == sizeof(read_time));
+        fflush(stdout);
+        _exit(test::failures == 0 ? 0 : 1);
+    }
+    close(fds[1]);
+    uint64_t read_time = 0;
+    bool received = read(fds[0], &read_time, sizeof(read_time)) == sizeof(read_time);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    REQUIRE(received && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    return read_time;
+}
+
+}
+
+TEST(pio_buses_read_concurrently) {
+    // The reads of the buses overlap, so more buses barely add time
+    uint64_t single_bus_time = measure_buses_isolated(1, OneWireBackend::Pio);
+    uint64_t four_bus_time = measure_buses_isolated(4, OneWireBackend::Pio);
+    CHECK(four_bus_time < single_bus_time * 3 / 2);
+}
+
+TEST(bit_bang_buses_read_one_after_another) {
+    // The CPU generates the slots, so the reads of the buses take turns
+    uint64_t single_bus_time = measure_buses_isolated(1, OneWireBackend::BitBang);
+    uint64_t four_bus_time = measure_buses_isolated(4, OneWireBackend::BitBang);
+    CHECK(four_bus_time > single_bus_time * 7 / 2);
+}
+
+TEST(pio_read_phase_scales_with_the_bus_count) {
+    for (size_t bus_count = 1; bus_count <= BusManager::m_max_buses; bus_count++) {
+        measure_buses_isolated(bus_count, OneWireBackend::Pio);
+    }
+}
+
+TEST_MAIN()
@@ -0,0 +1,80 @@
+#include "test.hpp"
+
+#include <chrono>
+
+#include "crc8.hpp"
+
+namespace {
+
+/**
+ * @return The time in ns per byte of the given update function, over a large block.
+ */
+double measure_ns_per_byte(uint8_t (*update)(uint8_t, uint8_t), uint8_t& crc) {
+    const size_t length = 1 << 20;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < length; i++) {
+        crc = update(crc, (uint8_t)i);
+    }
+    std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+
+    return duration.count() / length;
+}
+
+}
+
+TEST(tables_match_bitwise_calculation) {
+    for (int crc = 0; crc < 256; crc++) {
+        for (int byte = 0; byte < 256; byte++) {
+            uint8_t expected = Crc8::update_bitwise(crc, byte);
+            CHECK(Crc8::update(crc, byte) == expected);
+            CHECK(Crc8::update_table(crc, byte) == expected);
+            CHECK(Crc8::update_nibble_tables(crc, byte) == expected);
+        }
+    }
+}
+
+TEST(bits_match_bytes) {
+    for (int crc = 0; crc < 256; crc++) {
+        for (int byte = 0; byte < 256; byte++) {
+            uint8_t bit_crc = crc;
+            for (int i = 0; i < 8; i++) {
+                bit_crc = Crc8::update_bit(bit_crc, (byte >> i) & 0x01);
+            }
+            CHECK(bit_crc == Crc8::update(crc, byte));
+        }
+    }
+}
+
+TEST(rom_crc) {
+    // The example Rom of the Maxim application note 27
+    const uint8_t rom[] = { 0x02, 0x1C, 0xB8, 0x01, 0x00, 0x00, 0x00, 0xA2 };
+    CHECK(Crc8::calculate(rom, 7) == 0xA2);
+    CHECK(Crc8::calculate(rom, 8) == 0);
+    CHECK(Crc8::calculate(&rom[3], 4, Crc8::calculate(rom, 3)) == 0xA2);
+}
+
+TEST(block_with_its_crc_is_zero) {
+    uint8_t data[9];
+    for (int seed = 0; seed < 256; seed++) {
+        for (int i = 0; i < 8; i++) {
+            data[i] = seed * 31 + i * 97;
+        }
+        data[8] = Crc8::calculate(data, 8);
+        CHECK(Crc8::calculate(data, 9) == 0);
+        data[seed % 8] ^= 0x10;
+        CHECK(Crc8::calculate(data, 9) != 0);
+    }
+}
+
+TEST(throughput) {
+    uint8_t crc = 0;
+    double bitwise_ns = measure_ns_per_byte(Crc8::update_bitwise, crc);
+    double table_ns = measure_ns_per_byte(Crc8::update_table, crc);
+    double nibble_tables_ns = measure_ns_per_byte(Crc8::update_nibble_tables, crc);
+    printf("variant,ns_per_byte,table_bytes\n");
+    printf("bitwise,%.2f,0\n", bitwise_ns);
+    printf("table,%.2f,%d\n", table_ns, (int)Crc8::m_table_size);
+    printf("nibble_tables,%.2f,%d\n", nibble_tables_ns, (int)Crc8::m_nibble_tables_size);
+}
+
+TEST_MAIN()
@@ -0,0 +1,518 @@
+#include "test.hpp"
+
+#include "bus_simulator.hpp"
+#include "device_commands.hpp"
+#include "ds18b20.hpp"
+#include "ds18b20_bus.hpp"
+#include "ds18b20_registry.hpp"
+#include "hal.hpp"
+#include "one_wire.hpp"
+
+namespace {
+
+const int pin = 0;
+
+/**
+ * Polls a non-blocking measurement every millisecond, leaving the CPU idle in between (as other work would).
+ * @param elapsed_time_ms Set to the time the measurement took.
+ * @param busy_time_ns Set to the time the CPU spent in poll().
+ */
+ConversionState poll_until_done(Ds18b20& device, uint32_t& elapsed_time_ms, uint64_t& busy_time_ns) {
+    uint32_t start_time = Hal::get_time_ms();
+    uint64_t start_busy_time = Simulation::get_cpu_busy_ns();
+    ConversionState state = ConversionState::Converting;
+    while (state == ConversionState::Converting) {
+        Simulation::advance(1000000, false);
+        state = device.poll();
+    }
+    elapsed_time_ms = Hal::get_time_ms() - start_time;
+    busy_time_ns = Simulation::get_cpu_busy_ns() - start_busy_time;
+
+    return state;
+}
+
+void check_find_and_measure(OneWireBackend backend) {
+    BusSimulator bus(pin);
+    bus.add_device(0x111111).set_temperature(21.5f);
+    bus.add_device(0x222222).set_temperature(-10.125f);
+    bus.add_device(0x333333).set_temperature(30.0f);
+    OneWire one_wire(pin, backend);
+
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 3);
+    for (size_t i = 0; i < devices.size(); i++) {
+        CHECK(devices[i].is_successfully_initialized());
+    }
+
+    // The search finds the devices in the order of their Roms (LSB first)
+    for (size_t i = 0; i < devices.size(); i++) {
+        bool found = false;
+        for (size_t j = 0; j < bus.get_device_count(); j++) {
+            found = found || Rom::encode_rom(devices[i].get_rom()) == bus.get_device(j).get_rom();
+        }
+        CHECK(found);
+    }
+
+    for (size_t i = 0; i < devices.size(); i++) {
+        std::optional<float> temperature = devices[i].measure_temperature();
+        REQUIRE(temperature.has_value());
+        bool expected = false;
+        for (float t : { 21.5f, -10.125f, 30.0f }) {
+            expected = expected || temperature.value() == t;
+        }
+        CHECK(expected);
+    }
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+}
+
+TEST(find_and_measure_bit_bang) {
+    check_find_and_measure(OneWireBackend::BitBang);
+}
+
+TEST(find_and_measure_pio) {
+    check_find_and_measure(OneWireBackend::Pio);
+}
+
+TEST(measure_follows_the_temperature) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x123456);
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+
+    for (float temperature : { 25.0f, 24.9375f, 0.0f, -0.0625f, -55.0f, 125.0f }) {
+        device.set_temperature(temperature);
+        std::optional<float> result = devices[0].measure_temperature();
+        REQUIRE(result.has_value());
+        CHECK(result.value() == temperature);
+    }
+}
+
+TEST(fast_read_accepts_all_ones_temperature) {
+    // -0.0625 degrees reads as 0xFFFF, like the temperature bytes of a missing device
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x123456);
+    device.set_raw_temperature(-1);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+    devices[0].set_fast_read(true);
+    REQUIRE(devices[0].measure_temperature().has_value());
+
+    bus.set_recording(true);
+    bus.clear_records();
+    Sample sample = devices[0].measure_sample();
+    CHECK(sample.valid);
+    CHECK(sample.temperature == -1);
+    CHECK(sample.retries == 0);
+
+    // Match ROM (9 bytes), Read Scratchpad, then the first 5 bytes of the scratchpad
+    const std::vector<std::vector<uint8_t>>& frames = bus.get_frames();
+    REQUIRE(frames.size() >= 2);
+    const std::vector<uint8_t>& read_frame = frames[frames.size() - 2];
+    CHECK(read_frame.size() == 15);
+    CHECK(read_frame[9] == 0xBE);
+}
+
+TEST(fast_read_detects_a_missing_device_and_changed_settings) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x123456);
+    device.set_temperature(20.0f);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+    devices[0].set_fast_read(true);
+    REQUIRE(devices[0].measure_temperature().has_value());
+
+    // Settings that differ from the cached ones are found by a full read
+    device.set_eeprom(50, -10, 0x3F);
+    uint32_t scratchpad_reads = device.get_scratchpad_reads();
+    Sample sample = devices[0].measure_sample();
+    CHECK(sample.valid);
+    CHECK(sample.retries == 1);
+    CHECK(device.get_scratchpad_reads() == scratchpad_reads + 2);
+
+    device.set_connected(false);
+    CHECK(!devices[0].measure_sample().valid);
+}
+
+TEST(fast_read_saves_bus_time_at_every_device_count) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 64> devices;
+    printf("devices,mode,bus_time_us_per_sample,read_slots_per_sample,write_slots_per_sample\n");
+    const size_t device_counts[] = { 1, 8, 64 };
+    for (size_t device_count : device_counts) {
+        while (bus.get_device_count() < device_count) {
+            bus.add_device(0x1000 + bus.get_device_count()).set_temperature(21.5f);
+        }
+        REQUIRE(Ds18b20::find_devices(one_wire, devices) == SearchStatus::Complete);
+        REQUIRE(devices.size() == device_count);
+        REQUIRE(Ds18b20Bus(one_wire).convert_all());
+
+        // Read each device 4 times in full read mode, then in fast read mode (without the periodic full reads)
+        OneWireStatistics statistics[2];
+        for (int fast = 0; fast < 2; fast++) {
+            for (size_t i = 0; i < devices.size(); i++) {
+                devices[i].set_fast_read(fast == 1, 255);
+            }
+            one_wire.clear_statistics();
+            for (int sample = 0; sample < 4; sample++) {
+                for (size_t i = 0; i < devices.size(); i++) {
+                    REQUIRE(devices[i].read_temperature_raw() == 21.5f * 16);
+                }
+            }
+            statistics[fast] = one_wire.get_statistics();
+            size_t samples = 4 * device_count;
+            printf("%d,%s,%.1f,%d,%d\n", (int)device_count, fast == 1 ? "fast" : "full",
+                (double)statistics[fast].bus_time_us / samples, (int)(statistics[fast].read_slots / samples),
+                (int)(statistics[fast].write_slots / samples));
+            CHECK(statistics[fast].read_slots == samples * (fast == 1 ? 40 : 72));
+        }
+
+        // Both modes send the same Match ROM and Read Scratchpad (80 write slots), the fast read saves 32 read slots
+        CHECK(statistics[1].bus_time_us < statistics[0].bus_time_us * 9 / 10);
+    }
+}
+
+TEST(first_save_copies_settings_that_only_the_scratchpad_has) {
+    // A previous run wrote a 9-bit resolution to the scratchpad without saving it
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x123456);
+    OneWire one_wire(pin);
+    REQUIRE(one_wire.reset());
+    DeviceCommands::skip_rom(one_wire);
+    DeviceCommands::write_scratchpad(one_wire, 75, 70, 0x1F);
+    REQUIRE(device.get_scratchpad_configuration() == 0x1F);
+
+    // The scratchpad is left alone, and the first save copies it even though it already has the settings
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+    CHECK(devices[0].get_resolution() == Resolution::Low);
+    CHECK(device.get_scratchpad_configuration() == 0x1F);
+    REQUIRE(devices[0].set_resolution(Resolution::Low, true));
+    CHECK(device.get_eeprom_writes() == 1);
+    CHECK(device.get_eeprom_configuration() == 0x1F);
+
+    // Saving the same settings again is skipped
+    REQUIRE(devices[0].set_resolution(Resolution::Low, true));
+    CHECK(device.get_eeprom_writes() == 1);
+}
+
+TEST(corrupted_scratchpad_write_is_retried) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x123456);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+
+    // The read back detects the wrong TH, and the write is repeated
+    device.set_corrupted_scratchpad_writes(1);
+    CHECK(devices[0].set_temperature_high_limit(40, false));
+    CHECK(devices[0].get_temperature_high_limit() == 40);
+
+    // A device that keeps corrupting the writes fails the write
+    device.set_corrupted_scratchpad_writes(100);
+    CHECK(!devices[0].set_temperature_high_limit(50, false));
+    CHECK(devices[0].get_temperature_high_limit() != 50);
+}
+
+TEST(bus_measures_all_devices_with_a_single_conversion) {
+    BusSimulator bus(pin);
+    for (int i = 0; i < 5; i++) {
+        bus.add_device(0x1000 + i).set_temperature(20.0f + i);
+    }
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 5);
+
+    Ds18b20Bus ds18b20_bus(one_wire);
+    etl::vector<std::optional<float>, 10> temperatures;
+    bus.set_recording(true);
+    bus.clear_records();
+    uint32_t start_time = Hal::get_time_ms();
+    REQUIRE(ds18b20_bus.measure_temperatures(devices, temperatures));
+    uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+
+    // One Skip ROM + Convert T for all devices, then one read per device
+    REQUIRE(temperatures.size() == 5);
+    for (size_t i = 0; i < devices.size(); i++) {
+        REQUIRE(temperatures[i].has_value());
+        uint64_t serial = Rom::encode_rom(devices[i].get_rom());
+        for (size_t j = 0; j < bus.get_device_count(); j++) {
+            if (bus.get_device(j).get_rom() == serial) {
+                CHECK(temperatures[i].value() == 20.0f + j);
+                CHECK(bus.get_device(j).get_conversions() == 1);
+            }
+        }
+    }
+    int conversion_frames = 0;
+    for (const std::vector<uint8_t>& frame : bus.get_frames()) {
+        conversion_frames += frame.size() >= 2 && frame[0] == 0xCC && frame[1] == 0x44;
+    }
+    CHECK(conversion_frames == 1);
+    CHECK(elapsed_time < 2 * DeviceCommands::m_max_conversion_time_ms);
+    CHECK(bus.get_timing_violations() == 0);
+
+    // The power supply mode is only read by the first sweep
+    REQUIRE(ds18b20_bus.measure_temperatures(devices, temperatures));
+    int power_supply_frames = 0;
+    for (const std::vector<uint8_t>& frame : bus.get_frames()) {
+        power_supply_frames += frame.size() >= 2 && frame[0] == 0xCC && frame[1] == 0xB4;
+    }
+    CHECK(power_supply_frames == 1);
+}
+
+TEST(bus_configuration_continues_after_a_failed_device) {
+    BusSimulator bus(pin);
+    for (int i = 0; i < 3; i++) {
+        bus.add_device(0x1000 + i);
+    }
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 3);
+
+    // The first device no longer answers, the others still receive and verify the settings
+    for (size_t j = 0; j < bus.get_device_count(); j++) {
+        if (bus.get_device(j).get_rom() == Rom::encode_rom(devices[0].get_rom())) {
+            bus.get_device(j).set_connected(false);
+        }
+    }
+    Ds18b20Configuration configuration(Resolution::Medium, 60, -10);
+    CHECK(!Ds18b20Bus(one_wire).configure_all(devices, configuration, false));
+    CHECK(devices[0].get_temperature_high_limit() != 60);
+    for (size_t i = 1; i < devices.size(); i++) {
+        CHECK(devices[i].get_temperature_high_limit() == 60);
+        CHECK(devices[i].get_temperature_low_limit() == -10);
+        CHECK(devices[i].get_resolution() == Resolution::Medium);
+    }
+}
+
+TEST(lower_resolutions_shorten_the_conversion_wait_and_the_polling) {
+    BusSimulator bus(pin);
+    bus.add_device(0x123456).set_temperature(21.5f);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+    Ds18b20& device = devices[0];
+
+    printf("resolution,time_us_per_sample,bus_time_us_per_sample,polls_per_sample,polls_per_sample_at_5_ms\n");
+    const Resolution resolutions[4] = { Resolution::Low, Resolution::Medium, Resolution::High, Resolution::VeryHigh };
+    uint64_t previous_time_us = 0;
+    uint64_t previous_bus_time_us = 0;
+    for (int r = 0; r < 4; r++) {
+        REQUIRE(device.set_resolution(resolutions[r], false));
+
+        // Let the device learn the conversion time of the resolution first
+        REQUIRE(device.measure_temperature().has_value());
+
+        const int samples = 4;
+        one_wire.clear_statistics();
+        uint64_t start_time = Simulation::get_time_ns();
+        for (int i = 0; i < samples; i++) {
+            REQUIRE(device.measure_temperature().has_value());
+        }
+        uint64_t time_us = (Simulation::get_time_ns() - start_time) / 1000 / samples;
+        OneWireStatistics statistics = one_wire.get_statistics();
+        uint64_t bus_time_us = statistics.bus_time_us / samples;
+
+        // Each sample reads the scratchpad (72 read slots), the other read slots are completion checks
+        uint32_t polls = (statistics.read_slots - samples * 72) / samples;
+        printf("%d,%llu,%llu,%lu,%lu\n", 9 + r, (unsigned long long)time_us, (unsigned long long)bus_time_us,
+            (unsigned long)polls, (unsigned long)(time_us / 5000));
+
+        // The wait ends with a single early-completion check, instead of polling every 5 ms
+        CHECK(polls <= 2);
+        CHECK(time_us > previous_time_us);
+        CHECK(bus_time_us >= previous_bus_time_us);
+        previous_time_us = time_us;
+        previous_bus_time_us = bus_time_us;
+    }
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(poll_completes_the_conversion_while_the_cpu_is_free) {
+    BusSimulator bus(pin);
+    SimulatedDevice& simulated_device = bus.add_device(0x123456);
+    simulated_device.set_temperature(23.5f);
+    simulated_device.set_conversion_time_us(3, 600000);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+
+    REQUIRE(devices[0].start_conversion());
+    CHECK(!devices[0].result_ready());
+    uint32_t elapsed_time = 0;
+    uint64_t busy_time = 0;
+    CHECK(poll_until_done(devices[0], elapsed_time, busy_time) == ConversionState::Ready);
+    REQUIRE(devices[0].get_result().has_value());
+    CHECK(devices[0].get_result().value() == 23.5f);
+    CHECK(elapsed_time >= 600 && elapsed_time <= 760);
+
+    // The bus is only used for the completion checks and the read of the scratchpad
+    CHECK(busy_time < elapsed_time * 1000000ull / 20);
+    CHECK(simulated_device.get_conversions() == 1);
+}
+
+TEST(poll_fails_at_the_conversion_timeout) {
+    BusSimulator bus(pin);
+    bus.add_device(0x123456).set_conversion_time_us(3, 2000000);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+
+    REQUIRE(devices[0].start_conversion());
+    uint32_t elapsed_time = 0;
+    uint64_t busy_time = 0;
+    CHECK(poll_until_done(devices[0], elapsed_time, busy_time) == ConversionState::Failed);
+    CHECK(elapsed_time >= DeviceCommands::m_conversion_timeout_ms && elapsed_time <= DeviceCommands::m_conversion_timeout_ms + 10);
+    CHECK(!devices[0].get_result().has_value());
+}
+
+TEST(poll_holds_the_strong_pullup_in_parasite_mode) {
+    BusSimulator bus(pin);
+    bus.add_device(0x123456, true).set_temperature(-5.0f);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire);
+    REQUIRE(devices.size() == 1);
+    REQUIRE(devices[0].get_power_supply_mode() == PowerSupplyMode::Parasite);
+
+    REQUIRE(devices[0].start_conversion());
+    uint32_t elapsed_time = 0;
+    uint64_t busy_time = 0;
+    CHECK(poll_until_done(devices[0], elapsed_time, busy_time) == ConversionState::Ready);
+    REQUIRE(devices[0].get_result().has_value());
+    CHECK(devices[0].get_result().value() == -5.0f);
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(find_devices_on_an_empty_bus) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin);
+    CHECK(Ds18b20::find_devices(one_wire).size() == 0);
+}
+
+TEST(find_devices_reuses_known_devices_beyond_ten) {
+    BusSimulator bus(pin);
+    for (uint64_t i = 1; i <= 80; i++) {
+        bus.add_device(i * 0x10101);
+    }
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 100> known_devices;
+    CHECK(Ds18b20::find_devices(one_wire, known_devices) == SearchStatus::Complete);
+    REQUIRE(known_devices.size() == 80);
+
+    bus.get_device(5).set_connected(false);
+    bus.add_device(0xABCDEF);
+    uint32_t scratchpad_reads = bus.get_device(0).get_scratchpad_reads();
+    etl::vector<Ds18b20, 100> devices;
+    Ds18b20::find_devices(one_wire, known_devices, devices);
+    CHECK(devices.size() == 80);
+    CHECK(bus.get_device(0).get_scratchpad_reads() == scratchpad_reads);
+    CHECK(bus.get_device(80).get_scratchpad_reads() > 0);
+}
+
+TEST(re_enumeration_with_known_devices_saves_slots_at_every_device_count) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 64> known_devices;
+    etl::vector<Ds18b20, 65> devices;
+    printf("devices,mode,slots,bus_time_us\n");
+    const size_t device_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    size_t added_devices = 0;
+    uint32_t saving_per_device = 0;
+    for (size_t device_count : device_counts) {
+        while (added_devices < device_count) {
+            added_devices++;
+            bus.add_device(added_devices * 0x10101);
+        }
+        REQUIRE(Ds18b20::find_devices(one_wire, known_devices) == SearchStatus::Complete);
+        REQUIRE(known_devices.size() == device_count);
+
+        // Hot-plug one device, then enumerate the bus again without and with the known devices
+        SimulatedDevice& new_device = bus.add_device(0xABCDEF + device_count);
+        OneWireStatistics statistics[2];
+        for (int known = 0; known < 2; known++) {
+            one_wire.clear_statistics();
+            if (known == 1) {
+                REQUIRE(Ds18b20::find_devices(one_wire, known_devices, devices) == SearchStatus::Complete);
+            } else {
+                REQUIRE(Ds18b20::find_devices(one_wire, devices) == SearchStatus::Complete);
+            }
+            REQUIRE(devices.size() == device_count + 1);
+            statistics[known] = one_wire.get_statistics();
+            printf("%d,%s,%lu,%llu\n", (int)device_count, known == 1 ? "known" : "full",
+                (unsigned long)(statistics[known].read_slots + statistics[known].write_slots),
+                (unsigned long long)statistics[known].bus_time_us);
+        }
+        new_device.set_connected(false);
+
+        // Only the hot-plugged device is read, so the saving grows linearly with the number of known devices
+        uint32_t full_slots = statistics[0].read_slots + statistics[0].write_slots;
+        uint32_t known_slots = statistics[1].read_slots + statistics[1].write_slots;
+        REQUIRE(known_slots < full_slots);
+        if (saving_per_device == 0) {
+            saving_per_device = full_slots - known_slots;
+        }
+        CHECK(full_slots - known_slots == device_count * saving_per_device);
+        CHECK(statistics[1].bus_time_us < statistics[0].bus_time_us);
+    }
+}
+
+TEST(find_devices_stops_when_the_storage_is_full) {
+    BusSimulator bus(pin);
+    for (uint64_t i = 1; i <= 70; i++) {
+        bus.add_device(i * 0x10101);
+    }
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 64> devices;
+    CHECK(Ds18b20::find_devices(one_wire, devices) == SearchStatus::StorageFull);
+    CHECK(devices.size() == 64);
+
+    Ds18b20Registry<64> registry;
+    CHECK(registry.find_devices(one_wire) == 64);
+    CHECK(registry.get_search_status() == SearchStatus::StorageFull);
+}
+
+TEST(registry_finds_more_than_sixty_four_devices) {
+    BusSimulator bus(pin);
+    for (uint64_t i = 1; i <= 100; i++) {
+        bus.add_device(i * 0x10101).set_temperature(i * 0.5f);
+    }
+    OneWire one_wire(pin);
+    Ds18b20Registry<128> registry;
+    REQUIRE(registry.find_devices(one_wire) == 100);
+    CHECK(registry.get_search_status() == SearchStatus::Complete);
+    for (uint64_t i = 1; i <= 100; i++) {
+        CHECK(registry.index_of(bus.get_device(i - 1).get_rom()) >= 0);
+    }
+
+    REQUIRE(registry.measure_temperatures(one_wire));
+    CHECK(registry.read_temperatures(one_wire) == 100);
+    int index = registry.index_of(bus.get_device(99).get_rom());
+    REQUIRE(index >= 0);
+    CHECK(registry.get_raw_temperature(index) == 50 * 16);
+}
+
+TEST(search_stops_without_presence_pulse) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin);
+    RetryPolicies policies;
+    RetryPolicy policy;
+    policy.max_attempts = 3;
+    policies.set(RetryOperation::Ping, policy);
+    bus.clear_records();
+    etl::vector<Ds18b20, 10> devices;
+    CHECK(Ds18b20::find_devices(one_wire, devices, policies) == SearchStatus::NoPresence);
+    CHECK(devices.size() == 0);
+    CHECK(bus.get_resets() == 3);
+    CHECK(bus.get_slots() == 0);
+
+    Ds18b20Registry<4> registry;
+    CHECK(registry.find_devices(one_wire) == 0);
+    CHECK(registry.get_search_status() == SearchStatus::NoPresence);
+}
+
+TEST_MAIN()
@@ -0,0 +1,421 @@
+#include "test.hpp"
+
+#include <algorithm>
+
+#include "bus_simulator.hpp"
+#include "device_commands.hpp"
+#include "hal.hpp"
+#include "one_wire.hpp"
+#include "pio_emulator.hpp"
+
+namespace {
+
+const int pin = 0;
+
+/**
+ * Checks the reset, the written bytes and the read bytes of a backend against a simulated device.
+ */
+void check_read_rom(OneWireBackend backend) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x0000DEADBEEF);
+    OneWire one_wire(pin, backend);
+    REQUIRE(one_wire.get_backend() == backend);
+
+    bus.set_recording(true);
+    REQUIRE(one_wire.reset());
+    CommandResult<Rom> rom = DeviceCommands::read_rom(one_wire);
+    REQUIRE(rom.has_value());
+    CHECK(Rom::encode_rom(rom.value()) == device.get_rom());
+
+    // Read ROM, then 8 read slots (write 1 slots) per byte
+    REQUIRE(bus.get_frames().size() == 1);
+    const std::vector<uint8_t>& frame = bus.get_frames()[0];
+    REQUIRE(frame.size() == 9);
+    CHECK(frame[0] == 0x33);
+    for (size_t i = 1; i < frame.size(); i++) {
+        CHECK(frame[i] == 0xFF);
+    }
+    CHECK(bus.get_resets() == 1);
+    CHECK(bus.get_slots() == 72);
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+/**
+ * Checks that a scratchpad read by Rom is sent as a single frame: Match ROM, Read Scratchpad, then 9 read bytes.
+ */
+void check_read_scratchpad_transaction(OneWireBackend backend) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x0000DEADBEEF);
+    bus.add_device(0x000012345678);
+    OneWire one_wire(pin, backend);
+    Rom rom = Rom::decode_rom(device.get_rom());
+
+    bus.set_recording(true);
+    CommandResult<Scratchpad> scratchpad = DeviceCommands::read_scratchpad(one_wire, rom);
+    REQUIRE(scratchpad.has_value());
+    CHECK(scratchpad->get_raw_temperature() == 85 * 16);
+
+    REQUIRE(bus.get_frames().size() == 1);
+    const std::vector<uint8_t>& frame = bus.get_frames()[0];
+    REQUIRE(frame.size() == 19);
+    CHECK(frame[0] == 0x55);
+    for (size_t i = 1; i < 9; i++) {
+        CHECK(frame[i] == ((device.get_rom() >> (8 * (i - 1))) & 0xFF));
+    }
+    CHECK(frame[9] == 0xBE);
+    CHECK(bus.get_slots() == 152);
+    CHECK(bus.get_timing_violations() == 0);
+
+    // Without a device, the transaction stops after the reset
+    bus.clear_records();
+    device.set_connected(false);
+    bus.get_device(1).set_connected(false);
+    scratchpad = DeviceCommands::read_scratchpad(one_wire, rom);
+    REQUIRE(!scratchpad.has_value());
+    CHECK(scratchpad.get_error() == CommandError::NoPresence);
+    CHECK(bus.get_slots() == 0);
+}
+
+/**
+ * Reads the Rom of a device 20 times with a 30 us interrupt every 170 us.
+ * @return The number of reads that failed.
+ */
+int count_failed_reads_with_interrupts(OneWireInterruptMasking masking) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x0000DEADBEEF);
+    OneWire one_wire(pin);
+    one_wire.set_interrupt_masking(masking);
+    CHECK(one_wire.get_interrupt_masking() == masking);
+
+    Simulation::set_interrupts(170, 30);
+    int failures = 0;
+    for (int i = 0; i < 20; i++) {
+        if (!one_wire.reset()) {
+            failures++;
+            continue;
+        }
+        CommandResult<Rom> rom = DeviceCommands::read_rom(one_wire);
+        if (!rom.has_value() || Rom::encode_rom(rom.value()) != device.get_rom()) {
+            failures++;
+        }
+    }
+    CHECK(Simulation::get_interrupt_count() > 100);
+
+    return failures;
+}
+
+/**
+ * Enumerates a bus of 32 devices with Search ROM and prints the cost of the enumeration: one reset, the command and
+ * one triplet (3 slots) per Rom bit for each device.
+ */
+void check_enumeration_cost(OneWireBackend backend) {
+    const size_t device_count = 32;
+    BusSimulator bus(pin);
+    for (uint64_t i = 1; i <= device_count; i++) {
+        bus.add_device(i * 0x10203);
+    }
+    OneWire one_wire(pin, backend);
+    REQUIRE(one_wire.get_backend() == backend);
+
+    bus.clear_records();
+    uint64_t start_time = Simulation::get_time_ns();
+    uint64_t start_busy_time = Simulation::get_cpu_busy_ns();
+    std::vector<uint64_t> roms;
+    DeviceCommands::SearchInfo info{};
+    info.last_choice_path_size = -2;
+    while (info.last_choice_path_size != -1) {
+        REQUIRE(one_wire.reset());
+        CommandResult<DeviceCommands::SearchInfo> result =
+            DeviceCommands::search_rom(one_wire, info.last_choice_path, info.last_choice_path_size);
+        REQUIRE(result.has_value());
+        info = result.value();
+        roms.push_back(Rom::encode_rom(info.rom));
+    }
+    uint64_t time = Simulation::get_time_ns() - start_time;
+    uint64_t busy_time = Simulation::get_cpu_busy_ns() - start_busy_time;
+
+    REQUIRE(roms.size() == device_count);
+    for (size_t i = 0; i < device_count; i++) {
+        CHECK(std::count(roms.begin(), roms.end(), bus.get_device(i).get_rom()) == 1);
+    }
+    CHECK(bus.get_resets() == device_count);
+    CHECK(bus.get_slots() == device_count * (8 + 64 * 3));
+    CHECK(bus.get_timing_violations() == 0);
+    printf("Enumeration of %d devices: %d slots per device, %.2f ms per device (%.2f ms of CPU time)\n",
+        (int)device_count, (int)(bus.get_slots() / device_count), time / 1e6 / device_count,
+        busy_time / 1e6 / device_count);
+}
+
+/**
+ * Reads the scratchpad of a device by Rom at standard speed, then at overdrive speed, and prints the time of each
+ * transaction.
+ */
+void compare_transaction_times(OneWireBackend backend) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x0000DEADBEEF);
+    device.set_overdrive_capable(true);
+    OneWire one_wire(pin, backend);
+    REQUIRE(one_wire.get_backend() == backend);
+    Rom rom = Rom::decode_rom(device.get_rom());
+
+    uint64_t start_time = Simulation::get_time_ns();
+    REQUIRE(DeviceCommands::read_scratchpad(one_wire, rom).has_value());
+    uint64_t standard_time = Simulation::get_time_ns() - start_time;
+
+    REQUIRE(one_wire.reset());
+    DeviceCommands::overdrive_skip_rom(one_wire);
+    REQUIRE(device.is_overdrive());
+    start_time = Simulation::get_time_ns();
+    REQUIRE(DeviceCommands::read_scratchpad(one_wire, rom).has_value());
+    uint64_t overdrive_time = Simulation::get_time_ns() - start_time;
+    CHECK(bus.get_timing_violations() == 0);
+
+    // A reset and 152 slots, which are several times shorter at overdrive speed
+    printf("Read scratchpad by Rom: %.2f ms at standard speed, %.2f ms at overdrive speed (%.1fx)\n",
+        standard_time / 1e6, overdrive_time / 1e6, (double)standard_time / overdrive_time);
+    CHECK(overdrive_time * 5 < standard_time);
+}
+
+}
+
+TEST(reset_detects_presence_bit_bang) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin);
+    CHECK(!one_wire.reset());
+    bus.add_device(1);
+    CHECK(one_wire.reset());
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(reset_detects_presence_pio) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    REQUIRE(one_wire.get_backend() == OneWireBackend::Pio);
+    CHECK(!one_wire.reset());
+    bus.add_device(1);
+    CHECK(one_wire.reset());
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(read_rom_bit_bang) {
+    check_read_rom(OneWireBackend::BitBang);
+}
+
+TEST(read_rom_pio) {
+    check_read_rom(OneWireBackend::Pio);
+}
+
+TEST(read_rom_pio_without_dma) {
+    // The slot engine falls back to one FIFO exchange per byte
+    PioEmulator::claim_all_dma_channels();
+    check_read_rom(OneWireBackend::Pio);
+}
+
+TEST(pio_bit_then_byte_transfers_have_no_stale_slots) {
+    // A 1-bit or 2-bit transfer followed by a byte transfer must not issue slots for the unused bits of the
+    // previous FIFO entry
+    BusSimulator bus(pin);
+    bus.add_device(1);
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    REQUIRE(one_wire.get_backend() == OneWireBackend::Pio);
+
+    bus.set_recording(true);
+    REQUIRE(one_wire.reset());
+    one_wire.write_bit(1);
+    one_wire.write_byte(0xCC);
+    one_wire.triplet(false);
+    one_wire.write_byte(0x44);
+    one_wire.read_bit();
+    uint8_t data[2] = { 0xBE, 0x00 };
+    one_wire.write_bytes(data, 2);
+
+    CHECK(bus.get_slots() == 1 + 8 + 3 + 8 + 1 + 16);
+    REQUIRE(bus.get_frames().size() == 1);
+    const std::vector<uint8_t>& frame = bus.get_frames()[0];
+    REQUIRE(frame.size() == 4);
+
+    // The frame is decoded from the first slot, so the single bits shift the bytes
+    CHECK(frame[0] == (uint8_t)((0xCC << 1) | 1));
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(pio_reset_waits_for_the_end_of_the_last_slot) {
+    BusSimulator bus(pin);
+    bus.add_device(1);
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    REQUIRE(one_wire.reset());
+    one_wire.write_byte(0xCC);
+    CHECK(one_wire.reset());
+    one_wire.read_bit();
+    CHECK(one_wire.reset());
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(pio_overdrive_slots_are_within_the_overdrive_limits) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x0000DEADBEEF);
+    device.set_overdrive_capable(true);
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    REQUIRE(one_wire.get_backend() == OneWireBackend::Pio);
+
+    REQUIRE(one_wire.reset());
+    DeviceCommands::overdrive_skip_rom(one_wire);
+    REQUIRE(device.is_overdrive());
+
+    bus.set_recording(true);
+    REQUIRE(one_wire.reset());
+    CommandResult<Rom> rom = DeviceCommands::read_rom(one_wire);
+    REQUIRE(rom.has_value());
+    CHECK(Rom::encode_rom(rom.value()) == device.get_rom());
+    CHECK(device.is_overdrive());
+
+    // The reset is long enough for overdrive devices only, the slots have a low time of at least 1 us (tW1L, tRL)
+    // and are sampled within 2 us (tMSR)
+    REQUIRE(bus.get_records().size() == 1 + 72);
+    CHECK(bus.get_records()[0].reset);
+    CHECK(bus.get_records()[0].low_ns >= 48000 && bus.get_records()[0].low_ns <= 80000);
+    for (size_t i = 1; i < bus.get_records().size(); i++) {
+        const SlotRecord& record = bus.get_records()[i];
+        CHECK(record.overdrive);
+        CHECK(record.low_ns >= 1000);
+        if (i > 8) {
+            CHECK(record.sample_ns >= 0 && record.sample_ns <= 2000);
+        }
+    }
+    CHECK(bus.get_timing_violations() == 0);
+
+    // A standard speed reset switches the device back
+    one_wire.set_speed(OneWireSpeed::Standard);
+    CHECK(one_wire.reset());
+    CHECK(!device.is_overdrive());
+}
+
+TEST(bit_bang_overdrive_read_rom) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x0000DEADBEEF);
+    device.set_overdrive_capable(true);
+    OneWire one_wire(pin);
+
+    REQUIRE(one_wire.reset());
+    DeviceCommands::overdrive_skip_rom(one_wire);
+    REQUIRE(device.is_overdrive());
+    REQUIRE(one_wire.reset());
+    CommandResult<Rom> rom = DeviceCommands::read_rom(one_wire);
+    REQUIRE(rom.has_value());
+    CHECK(Rom::encode_rom(rom.value()) == device.get_rom());
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(overdrive_transaction_time_bit_bang) {
+    compare_transaction_times(OneWireBackend::BitBang);
+}
+
+TEST(overdrive_transaction_time_pio) {
+    compare_transaction_times(OneWireBackend::Pio);
+}
+
+TEST(pio_falls_back_to_bit_bang_when_no_state_machine_is_free) {
+    BusSimulator bus(pin);
+    bus.add_device(1);
+    int engines = 0;
+    while (Hal::claim_slot_engine(pin + 1, 1) >= 0) {
+        engines++;
+    }
+    CHECK(engines == 8);
+
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    CHECK(one_wire.get_backend() == OneWireBackend::BitBang);
+    CHECK(one_wire.reset());
+}
+
+TEST(bit_bang_slots_follow_the_timing_profile) {
+    BusSimulator bus(pin);
+    bus.add_device(1);
+    OneWire one_wire(pin);
+    OneWireTiming custom_timing = OneWire::m_standard_timing;
+    custom_timing.write_0_low_us = 90;
+    custom_timing.read_sample_us = 10;
+
+    const OneWireTimingProfile profiles[] = { OneWireTimingProfile::Standard, OneWireTimingProfile::LongLine,
+        OneWireTimingProfile::ShortLine, OneWireTimingProfile::Custom };
+    for (OneWireTimingProfile profile : profiles) {
+        if (profile == OneWireTimingProfile::Custom) {
+            one_wire.set_timing(custom_timing);
+        } else {
+            one_wire.set_timing_profile(profile);
+        }
+        CHECK(one_wire.get_timing_profile() == profile);
+        const OneWireTiming& timing = one_wire.get_timing();
+
+        bus.set_recording(true);
+        bus.clear_records();
+        REQUIRE(one_wire.reset());
+        one_wire.write_bit(1);
+        one_wire.write_bit(0);
+        one_wire.read_bit();
+        REQUIRE(bus.get_records().size() == 4);
+        const SlotRecord& write_1 = bus.get_records()[1];
+        const SlotRecord& write_0 = bus.get_records()[2];
+        const SlotRecord& read = bus.get_records()[3];
+        CHECK(write_1.low_ns == timing.write_1_low_us * 1000ull);
+        CHECK(write_0.low_ns == timing.write_0_low_us * 1000ull);
+        CHECK(read.low_ns == timing.read_low_us * 1000ull);
+        CHECK(read.sample_ns == (timing.read_low_us + timing.read_sample_us) * 1000ll);
+        CHECK(write_0.start_ns - write_1.start_ns == (timing.write_1_low_us + timing.write_1_high_us + timing.write_recovery_us) * 1000ull);
+        CHECK(read.start_ns - write_0.start_ns == (timing.write_0_low_us + timing.write_recovery_us) * 1000ull);
+        CHECK(bus.get_timing_violations() == 0);
+    }
+}
+
+TEST(unmasked_interrupts_corrupt_bit_bang_slots) {
+    CHECK(count_failed_reads_with_interrupts(OneWireInterruptMasking::None) > 0);
+}
+
+TEST(slot_interrupt_masking_protects_bit_bang_slots) {
+    CHECK(count_failed_reads_with_interrupts(OneWireInterruptMasking::Slot) == 0);
+}
+
+TEST(byte_interrupt_masking_protects_bit_bang_slots) {
+    CHECK(count_failed_reads_with_interrupts(OneWireInterruptMasking::Byte) == 0);
+}
+
+TEST(read_scratchpad_transaction_bit_bang) {
+    check_read_scratchpad_transaction(OneWireBackend::BitBang);
+}
+
+TEST(read_scratchpad_transaction_pio) {
+    check_read_scratchpad_transaction(OneWireBackend::Pio);
+}
+
+TEST(pio_transaction_runs_while_the_cpu_is_free) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(0x0000DEADBEEF);
+    OneWire one_wire(pin, OneWireBackend::Pio);
+    REQUIRE(one_wire.get_backend() == OneWireBackend::Pio);
+
+    uint8_t command = 0x33;
+    uint8_t data[8] = {};
+    REQUIRE(one_wire.start_transaction(&command, 1, data, 8));
+    CHECK(!one_wire.is_transaction_complete());
+
+    // The 72 slots take about 5 ms, during which the CPU does not poll the bus
+    uint64_t busy_time_ns = Simulation::get_cpu_busy_ns();
+    Simulation::advance(10000000, false);
+    CHECK(Simulation::get_cpu_busy_ns() - busy_time_ns < 10000);
+    CHECK(one_wire.is_transaction_complete());
+    CHECK(one_wire.is_transaction_complete());
+    Rom rom(data[0], &data[1], data[7]);
+    CHECK(Rom::encode_rom(rom) == device.get_rom());
+    CHECK(one_wire.get_crc() == 0);
+    CHECK(bus.get_timing_violations() == 0);
+}
+
+TEST(enumeration_cost_bit_bang) {
+    check_enumeration_cost(OneWireBackend::BitBang);
+}
+
+TEST(enumeration_cost_pio) {
+    check_enumeration_cost(OneWireBackend::Pio);
+}
+
+TEST_MAIN()
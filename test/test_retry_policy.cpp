@@ -0,0 +1,167 @@
+#include "test.hpp"
+
+#include "bus_manager.hpp"
+#include "bus_simulator.hpp"
+#include "ds18b20.hpp"
+#include "ds18b20_registry.hpp"
+#include "hal.hpp"
+#include "one_wire.hpp"
+
+namespace {
+
+const int pin = 0;
+
+RetryPolicy make_policy(int max_attempts, uint32_t deadline_us) {
+    RetryPolicy policy;
+    policy.max_attempts = max_attempts;
+    policy.initial_backoff_us = 1000;
+    policy.max_backoff_us = 8000;
+    policy.deadline_us = deadline_us;
+    return policy;
+}
+
+}
+
+TEST(backoff_without_maximum_keeps_doubling) {
+    RetryPolicy policy;
+    policy.max_attempts = 4;
+    policy.initial_backoff_us = 1000;
+    uint64_t start_time = Hal::get_time_us();
+    Retry retry(policy);
+    while (retry.next()) {
+    }
+    CHECK(retry.get_attempts() == 4);
+    CHECK(Hal::get_time_us() - start_time == 1000 + 2000 + 4000);
+}
+
+TEST(backoff_stops_at_the_maximum) {
+    RetryPolicy policy = make_policy(6, 0);
+    uint64_t start_time = Hal::get_time_us();
+    Retry retry(policy);
+    while (retry.next()) {
+    }
+    CHECK(retry.get_attempts() == 6);
+    CHECK(Hal::get_time_us() - start_time == 1000 + 2000 + 4000 + 8000 + 8000);
+}
+
+TEST(measure_of_a_missing_device_ends_at_the_deadline) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(1);
+    OneWire one_wire(pin);
+    RetryPolicies policies;
+    policies.set(RetryOperation::Measure, make_policy(100, 50000));
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire, policies);
+    REQUIRE(devices.size() == 1);
+
+    device.set_connected(false);
+    uint32_t start_time = Hal::get_time_ms();
+    Sample sample = devices[0].measure_sample();
+    uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+    CHECK(!sample.valid);
+    CHECK(elapsed_time >= 40 && elapsed_time <= 55);
+}
+
+TEST(measure_near_the_deadline_does_not_sleep_the_whole_conversion_time) {
+    // The conversion takes longer than the deadline: the measurement fails at the deadline
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(1);
+    device.set_conversion_time_us(3, 600000);
+    OneWire one_wire(pin);
+    RetryPolicies policies;
+    policies.set(RetryOperation::Measure, make_policy(1, 100000));
+    etl::vector<Ds18b20, 10> devices = Ds18b20::find_devices(one_wire, policies);
+    REQUIRE(devices.size() == 1);
+
+    // The deadline runs in microseconds from the first attempt, the elapsed time is truncated to milliseconds
+    uint32_t start_time = Hal::get_time_ms();
+    CHECK(!devices[0].measure_sample().valid);
+    uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+    CHECK(elapsed_time >= 99 && elapsed_time <= 105);
+}
+
+TEST(convert_t_checks_the_completion_at_the_timeout) {
+    // The conversion is faster than expected: it is found complete by the single check at the timeout
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(1);
+    device.set_conversion_time_us(3, 20000);
+    OneWire one_wire(pin);
+    REQUIRE(one_wire.reset());
+    DeviceCommands::skip_rom(one_wire);
+    CommandResult<uint32_t> time = DeviceCommands::convert_t(one_wire, PowerSupplyMode::External, 750, 50);
+    REQUIRE(time.has_value());
+    CHECK(time.value() >= 50 && time.value() <= 51);
+    CHECK(device.get_conversions() == 1);
+}
+
+TEST(registry_uses_its_retry_policies) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(1);
+    OneWire one_wire(pin);
+    RetryPolicies policies;
+    policies.set(RetryOperation::Read, make_policy(3, 0));
+    Ds18b20Registry<4> registry(policies);
+    REQUIRE(registry.find_devices(one_wire) == 1);
+
+    device.set_connected(false);
+    bus.clear_records();
+    CHECK(registry.read_temperatures(one_wire) == 0);
+    CHECK(bus.get_resets() == 3);
+}
+
+TEST(registry_alarm_scan_uses_the_alarm_policy) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(1);
+    OneWire one_wire(pin);
+    RetryPolicies policies;
+    policies.set(RetryOperation::Alarm, make_policy(4, 0));
+    Ds18b20Registry<4> registry(policies);
+    REQUIRE(registry.find_devices(one_wire) == 1);
+
+    device.set_connected(false);
+    bus.clear_records();
+    CHECK(!registry.scan_alarms(one_wire).has_value());
+    CHECK(bus.get_resets() == 4);
+}
+
+TEST(registry_alarm_measurement_uses_the_measure_policy) {
+    // The conversion takes longer than the deadline: the measurement fails at the deadline
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(1);
+    device.set_conversion_time_us(3, 600000);
+    OneWire one_wire(pin);
+    RetryPolicies policies;
+    policies.set(RetryOperation::Measure, make_policy(1, 100000));
+    Ds18b20Registry<4> registry(policies);
+    REQUIRE(registry.find_devices(one_wire) == 1);
+
+    uint32_t start_time = Hal::get_time_ms();
+    CHECK(!registry.measure_alarms(one_wire).has_value());
+    uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+    CHECK(elapsed_time >= 99 && elapsed_time <= 105);
+}
+
+TEST(bus_manager_wait_ends_at_the_deadline) {
+    BusSimulator bus(pin);
+    SimulatedDevice& device = bus.add_device(1);
+    device.set_conversion_time_us(3, 600000);
+    OneWire one_wire(pin);
+    Ds18b20Registry<4> registry;
+    REQUIRE(registry.find_devices(one_wire) == 1);
+
+    RetryPolicies policies;
+    policies.set(RetryOperation::Measure, make_policy(1, 100000));
+    BusManager manager(policies);
+    REQUIRE(manager.add_bus(one_wire, registry));
+    uint32_t start_time = Hal::get_time_ms();
+    CHECK(manager.measure_temperatures() == 0);
+    uint32_t elapsed_time = Hal::get_time_ms() - start_time;
+    CHECK(elapsed_time >= 100 && elapsed_time <= 105);
+
+    // Without a deadline, the conversion completes
+    device.set_conversion_time_us(3, 20000);
+    BusManager default_manager;
+    REQUIRE(default_manager.add_bus(one_wire, registry));
+    CHECK(default_manager.measure_temperatures() == 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,103 @@
+#include "test.hpp"
+
+#include <string>
+
+#include "bus_simulator.hpp"
+#include "ds18b20.hpp"
+#include "one_wire.hpp"
+#include "rom_cache.hpp"
+
+namespace {
+
+const int pin = 0;
+
+std::string get_storage_file(const char* name) {
+    std::string path = std::string("/tmp/ds18b20_") + name + "_" + std::to_string(getpid());
+    remove(path.c_str());
+    return path;
+}
+
+}
+
+TEST(cached_startup_skips_the_search) {
+    std::string storage_file = get_storage_file("cache");
+    Simulation::set_storage_file(storage_file);
+    BusSimulator bus(pin);
+    for (uint64_t serial = 1; serial <= 5; serial++) {
+        bus.add_device(serial * 0x010101);
+    }
+
+    // Cold start: the bus is searched and the devices are saved
+    uint64_t cold_slots;
+    {
+        OneWire one_wire(pin);
+        etl::vector<Ds18b20, 10> devices;
+        CHECK(!RomCache::find_devices(one_wire, devices));
+        CHECK(devices.size() == 5);
+        cold_slots = bus.get_slots();
+    }
+
+    // Restart: the storage is loaded from the file again and each device is validated without a search
+    Simulation::set_storage_file(storage_file);
+    bus.clear_records();
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices;
+    CHECK(RomCache::find_devices(one_wire, devices));
+    REQUIRE(devices.size() == 5);
+    for (size_t i = 0; i < devices.size(); i++) {
+        CHECK(devices[i].is_successfully_initialized());
+        bool found = false;
+        for (size_t j = 0; j < bus.get_device_count(); j++) {
+            found = found || Rom::encode_rom(devices[i].get_rom()) == bus.get_device(j).get_rom();
+        }
+        CHECK(found);
+    }
+    CHECK(bus.get_slots() < cold_slots / 2);
+    printf("cold start: %llu slots, cached start: %u slots\n", (unsigned long long)cold_slots, bus.get_slots());
+
+    remove(storage_file.c_str());
+}
+
+TEST(cache_is_invalidated_by_a_missing_device) {
+    BusSimulator bus(pin);
+    bus.add_device(1);
+    bus.add_device(2);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices;
+    CHECK(!RomCache::find_devices(one_wire, devices));
+
+    bus.get_device(1).set_connected(false);
+    CHECK(!RomCache::find_devices(one_wire, devices));
+    CHECK(devices.size() == 1);
+    CHECK(RomCache::find_devices(one_wire, devices));
+    CHECK(devices.size() == 1);
+}
+
+TEST(empty_bus_is_not_cached) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices;
+    CHECK(!RomCache::find_devices(one_wire, devices));
+    CHECK(devices.empty());
+
+    // A device connected later is found by the next startup
+    bus.add_device(1);
+    CHECK(!RomCache::find_devices(one_wire, devices));
+    CHECK(devices.size() == 1);
+    CHECK(RomCache::find_devices(one_wire, devices));
+    CHECK(devices.size() == 1);
+}
+
+TEST(stored_empty_cache_is_a_miss) {
+    BusSimulator bus(pin);
+    OneWire one_wire(pin);
+    etl::vector<Ds18b20, 10> devices;
+    CHECK(RomCache::save(devices));
+    CHECK(!RomCache::load(one_wire, devices));
+
+    bus.add_device(1);
+    CHECK(!RomCache::find_devices(one_wire, devices));
+    CHECK(devices.size() == 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,75 @@
+#include "test.hpp"
+
+#include <thread>
+
+#include "spsc_ring.hpp"
+
+namespace {
+
+/// An item whose fields must arrive together, so a torn or reordered item is detected
+struct Item {
+    uint32_t sequence;
+    uint32_t check;
+};
+
+uint32_t get_check(uint32_t sequence) {
+    return sequence * 2654435761u;
+}
+
+}
+
+TEST(ring_keeps_the_order_and_drops_items_when_full) {
+    SpscRing<int, 4> ring;
+    int item = 0;
+    CHECK(!ring.pop(item));
+    for (int i = 0; i < 4; i++) {
+        CHECK(ring.push(i));
+    }
+    CHECK(!ring.push(4));
+    CHECK(ring.size() == 4);
+    CHECK(ring.get_overflow_count() == 1);
+
+    // The indices wrap around the storage
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(ring.pop(item));
+        CHECK(item == i);
+        CHECK(ring.push(i + 4));
+    }
+    CHECK(ring.size() == 4);
+    CHECK(ring.get_overflow_count() == 1);
+}
+
+TEST(producer_and_consumer_threads_exchange_all_items) {
+    // The producer retries when the ring is full, so every item arrives once and in order. Both threads yield while
+    // they wait, for machines with a single core. Build with DS18B20_TSAN to check the memory ordering.
+    static const uint32_t item_count = 2000000;
+    static SpscRing<Item, 64> ring;
+    uint32_t failed_pushes = 0;
+    std::thread producer([&failed_pushes]() {
+        for (uint32_t i = 0; i < item_count; i++) {
+            while (!ring.push({ i, get_check(i) })) {
+                failed_pushes++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    while (received < item_count) {
+        Item item;
+        if (!ring.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        errors += item.sequence != received || item.check != get_check(received);
+        received++;
+    }
+    producer.join();
+
+    CHECK(errors == 0);
+    CHECK(ring.size() == 0);
+    CHECK(ring.get_overflow_count() == failed_pushes);
+}
+
+TEST_MAIN()
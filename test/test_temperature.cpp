@@ -0,0 +1,93 @@
+#include "test.hpp"
+
+#include <chrono>
+#include <math.h>
+#include <vector>
+
+#include "scratchpad.hpp"
+#include "temperature.hpp"
+
+namespace {
+
+// The raw temperatures of the measurement range of a ds18b20 (-55 to 125 degrees, in 1/16 degree steps)
+const int16_t min_raw_temperature = -55 * 16;
+const int16_t max_raw_temperature = 125 * 16;
+
+/**
+ * @return A scratchpad holding the raw temperature, at the resolution of the configuration setting (0 to 3).
+ */
+Scratchpad make_scratchpad(int16_t raw, int config_setting) {
+    uint8_t temperature[2] = { (uint8_t)(raw & 0xFF), (uint8_t)((uint16_t)raw >> 8) };
+    uint8_t reserved[3] = { 0xFF, 0x00, 0x10 };
+    return Scratchpad(temperature, 75, 70, 0b00011111 | (config_setting << 5), reserved, 0);
+}
+
+/**
+ * @return The time in ns per conversion of the given function, over the scratchpads.
+ */
+template <typename Conversion>
+double measure_ns_per_conversion(const std::vector<Scratchpad>& scratchpads, Conversion conversion) {
+    const int rounds = 1000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const Scratchpad& scratchpad : scratchpads) {
+            conversion(scratchpad);
+        }
+    }
+    std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+
+    return duration.count() / rounds / scratchpads.size();
+}
+
+}
+
+TEST(fixed_point_matches_float_at_every_resolution) {
+    for (int config_setting = 0; config_setting < 4; config_setting++) {
+        for (int raw = min_raw_temperature; raw <= max_raw_temperature; raw++) {
+            Scratchpad scratchpad = make_scratchpad(raw, config_setting);
+            int16_t masked_raw = scratchpad.get_raw_temperature();
+            CHECK(masked_raw == (raw & ~((1 << (3 - config_setting)) - 1)));
+
+            float temperature = scratchpad.calculate_temperature();
+            CHECK(Temperature<4>::from_raw(masked_raw).to_float() == temperature);
+            CHECK(Temperature<8>::from_raw(masked_raw).to_float() == temperature);
+            CHECK(Temperature<16>::from_raw(masked_raw).to_float() == temperature);
+            CHECK(Temperature<1>::from_raw(masked_raw).to_float() == floorf(temperature * 2) / 2);
+            CHECK(Temperature<4>::from_raw(masked_raw).to_degrees() == (int32_t)floorf(temperature));
+            CHECK(scratchpad.calculate_temperature_centi() == lroundf(temperature * 100));
+        }
+    }
+}
+
+TEST(fixed_point_comparisons_follow_the_temperature) {
+    Temperature<4> limit = Temperature<4>::from_degrees(30);
+    CHECK(Temperature<4>::from_raw(30 * 16 + 1) > limit);
+    CHECK(Temperature<4>::from_raw(30 * 16) == limit);
+    CHECK(Temperature<4>::from_raw(-1) < Temperature<4>());
+    CHECK(Temperature<4>::from_raw(-8).to_centi_degrees() == -50);
+}
+
+TEST(throughput) {
+    // On the host, the float conversion uses the FPU: on the RP2040, it calls the soft-float routines instead
+    std::vector<Scratchpad> scratchpads;
+    for (int raw = min_raw_temperature; raw <= max_raw_temperature; raw++) {
+        scratchpads.push_back(make_scratchpad(raw, 3));
+    }
+    volatile float float_sink = 0;
+    volatile int32_t fixed_sink = 0;
+    double float_ns = measure_ns_per_conversion(scratchpads, [&](const Scratchpad& scratchpad) {
+        float_sink = scratchpad.calculate_temperature();
+    });
+    double centi_ns = measure_ns_per_conversion(scratchpads, [&](const Scratchpad& scratchpad) {
+        fixed_sink = scratchpad.calculate_temperature_centi();
+    });
+    double fixed_ns = measure_ns_per_conversion(scratchpads, [&](const Scratchpad& scratchpad) {
+        fixed_sink = Temperature<8>::from_raw(scratchpad.get_raw_temperature()).get_value();
+    });
+    printf("conversion,ns_per_conversion\n");
+    printf("float,%.2f\n", float_ns);
+    printf("centi_degrees,%.2f\n", centi_ns);
+    printf("fixed_point,%.2f\n", fixed_ns);
+}
+
+TEST_MAIN()